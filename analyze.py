@@ -5,12 +5,22 @@
 # A Python module to analyze results files and produce a table.
 # The main analyzes results files and produce an analysis in RESULTS.txt.
 # With option --pprint, print the data structure instead of creating the file.
+# With option --compare [label=]file ..., print a side-by-side comparison of
+# several results files from the same host, for instance with different options.
+# With option --record file ..., append a run to the history of the host.
+# With option --compare-history [ref [new]], compare two runs of the history
+# and report the statistically significant differences. Each results file is one
+# sample per test: record several results files of repeated executions in each run.
+# With option --html [file], also produce an HTML report with SVG charts.
 #----------------------------------------------------------------------------
 
-import re, os, sys, pprint
+import re, os, sys, math, json, socket, datetime, html, pprint
 
 #
-# List of CPU cores and corresponding result files.
+# Description of the legacy result files, without host metadata.
+# All files in the results directory are analyzed. The files from recent
+# versions of rsabench describe their host (host-xxx lines) and do not need
+# to be listed here. The order of this list is the order of the columns.
 #
 RESULTS = [
     {'cpu': 'i7-8565U',     'core': 'Whiskey Lake',  'frequency': 4.20, 'file': 'intel-i7-8565U-linux-vm.txt'},
@@ -56,9 +66,33 @@ REF_CYCLES  = 1000000000
 # List values for which "lower is better". By default, "higher is better".
 #
 OP_NAMES    = ['oaep-encrypt', 'oaep-decrypt', 'pss-sign', 'pss-verify']
-VALUE_NAMES = ['oprate', 'opcycle', 'cycles']
+VALUE_NAMES = ['oprate', 'opcycle', 'cycles', 'opjoule']
 LOWER_IS_BETTER = {'cycles': True}
 
+#
+# A test is reported as throttled when its measured frequency is below this
+# ratio of the nominal frequency (or of the fastest test in the same file).
+#
+THROTTLE_RATIO = 0.90
+
+#
+# HTML report: chart titles of the values, colors of the CPU's in the scaling curves.
+#
+CHART_TITLES = {'oprate': 'Operations per second',
+                'opcycle': 'Operations per %s cycles' % format(REF_CYCLES, ','),
+                'cycles': 'Cycles per operation (lower is better)'}
+COLORS = ['#1f77b4', '#ff7f0e', '#2ca02c', '#d62728', '#9467bd', '#8c564b', '#e377c2', '#7f7f7f',
+          '#bcbd22', '#17becf', '#393b79', '#637939', '#8c6d31', '#843c39', '#7b4173', '#3182bd']
+
+#
+# History of runs: one JSON object per line, appended by --record. A difference
+# between two runs is reported when the p-value of the Welch's t-test is below
+# SIGNIFICANCE and the relative difference is above MIN_DIFFERENCE (in percent).
+#
+HISTORY_FILE   = 'results/history.jsonl'
+SIGNIFICANCE   = 0.05
+MIN_DIFFERENCE = 1.0
+
 ##
 # Format a float for display.
 #
@@ -75,12 +109,31 @@ def format_num(value):
     else:
         return '%.3f' % value
 
+##
+# Compute the per-cycle values of an operation from its duration and count.
+#
+# @param [in,out] data Dictionary of values of an operation.
+# @param [in] frequency CPU frequency in GHz. Ignored if zero.
+#
+def set_cycle_values(data, frequency):
+    if 'count' in data and data['count'] > 0 and frequency > 0:
+        opcycle = (REF_CYCLES * data['count']) / (1000 * data['microsec'] * frequency)
+        cycles = (1000 * data['microsec'] * frequency) / data['count']
+        data['opcycle']['value'] = opcycle
+        data['opcycle']['string'] = format_num(opcycle)
+        data['cycles']['value'] = cycles
+        data['cycles']['string'] = format_num(cycles)
+
 ##
 # Load and analyze a "results" structure.
 #
 # A "results" structure is a list of dictionaries. Each dictionary describes one test.
-# In a test dictionary, the two mandatory fields are 'frequency' (in GHz) and 'file'
-# (containing the output of aesbench).
+# In a test dictionary, the mandatory field is 'file' (containing the output of rsabench).
+# The optional field 'frequency' (in GHz) is the nominal frequency, used for the legacy
+# files without measured frequency. When the file contains the measured frequency of
+# each test (-effective-mhz), the per-cycle values use it. The frequency which is measured
+# after a test without cycles counter (-post-test-mhz) is not used: it is not the
+# frequency during the test.
 #
 # @param [in,out] results List of results. Each result is updated with data from the file.
 # @param [in] input_dir Base directory for input file names. All file names are updated.
@@ -96,9 +149,12 @@ def load_results(results, input_dir):
         if not os.path.isabs(res['file']):
             res['file'] = os.path.abspath(input_dir + os.path.sep + res['file'])
         if not os.path.exists(res['file']):
+            print('warning: %s not found' % res['file'], file=sys.stderr)
             del results[index]
             continue
-        res['freq'] = '%.2f GHz' % (res['frequency'])
+        if not 'frequency' in res:
+            res['frequency'] = 0.0
+        res['freq'] = '%.2f GHz' % (res['frequency']) if res['frequency'] > 0 else ''
         if not 'openssl' in res:
             res['openssl'] = ''
         res['data'] = {}
@@ -125,20 +181,40 @@ def load_results(results, input_dir):
                         match = re.search(r'([0-9\.]+[a-zA-Z]*)', line[1])
                         if match is not None:
                             res['openssl'] = match.group(1)
-                    elif value == 'microsec' and algo is not None:
+                    elif line[0].endswith('-ops-per-joule') and algo is not None and line[0][:-14] in OP_NAMES:
+                        opjoule = float(line[1])
+                        data = res['data'][algo][line[0][:-14]]
+                        data['opjoule']['value'] = opjoule
+                        data['opjoule']['string'] = format_num(opjoule)
+                    elif line[0].endswith('-effective-mhz') and algo is not None and line[0][:-14] in OP_NAMES:
+                        # Measured frequency, after the count: replace the nominal frequency.
+                        data = res['data'][algo][line[0][:-14]]
+                        data['mhz'] = float(line[1])
+                        set_cycle_values(data, data['mhz'] / 1000.0)
+                    elif value == 'microsec' and algo is not None and op in OP_NAMES:
                         microsec = float(line[1])
-                    elif value == 'count' and algo is not None:
+                    elif value == 'count' and algo is not None and op in OP_NAMES:
                         count = float(line[1])
                         oprate = (REF_SECONDS * 1000000 * count) / microsec
-                        opcycle = (REF_CYCLES * count) / (1000 * microsec * res['frequency'])
-                        cycles = (1000 * microsec * res['frequency']) / count if count > 0.0 else 0.0
                         data = res['data'][algo][op]
+                        data['microsec'] = microsec
+                        data['count'] = count
                         data['oprate']['value'] = oprate
                         data['oprate']['string'] = format_num(oprate)
-                        data['opcycle']['value'] = opcycle
-                        data['opcycle']['string'] = format_num(opcycle)
-                        data['cycles']['value'] = cycles
-                        data['cycles']['string'] = format_num(cycles)
+                        set_cycle_values(data, res['frequency'])
+
+    # Without nominal frequency, display the mean measured frequency. Detect throttled tests.
+    for res in results:
+        mhz = [(algo, op, res['data'][algo][op]['mhz']) for algo in res['data'] for op in res['data'][algo]
+               if 'mhz' in res['data'][algo][op]]
+        if len(mhz) > 0 and res['frequency'] <= 0:
+            res['freq'] = '%.2f GHz' % (sum([m[2] for m in mhz]) / (1000.0 * len(mhz)))
+        if len(mhz) > 0:
+            ref = 1000.0 * res['frequency'] if res['frequency'] > 0 else max([m[2] for m in mhz])
+            for algo, op, value in mhz:
+                if value < THROTTLE_RATIO * ref:
+                    print('warning: %s: %s %s ran at %.0f MHz, %.0f%% below %.0f MHz, probably throttled' %
+                          (os.path.basename(res['file']), algo, op, value, 100.0 * (1.0 - value / ref), ref), file=sys.stderr)
 
     # Remove operations without results (eg. sign with KEM algo).
     for algo in algos:
@@ -262,15 +338,516 @@ def display_tables(results, algos, headers, file, colsep=SEPARATOR):
     print('CYCLES PER CRYPTOGRAPHIC OPERATION', file=file)
     print('', file=file)
     display_one_table(results, algos, headers, 'cycles', file, colsep)
+    energy = energy_results(results, algos)
+    if len(energy) > 0:
+        print('', file=file)
+        print('CRYPTOGRAPHIC OPERATIONS PER JOULE', file=file)
+        print('', file=file)
+        display_one_table(energy, algos, headers, 'opjoule', file, colsep)
+
+##
+# Get the results which contain energy measurements.
+#
+# @param [in] results Table results.
+# @param [in] algos List of algorithms.
+# @return The list of results with at least one number of operations per joule.
+#
+def energy_results(results, algos):
+    return [res for res in results
+            if any(res['data'][algo][op]['opjoule']['value'] > 0 for algo in algos for op in res['data'][algo])]
+
+##
+# Build a results structure from a list of files to compare.
+#
+# @param [in] specs List of file specifications, 'label=file' or 'file'.
+# Without label, the file name without directory and extension is used.
+# @return A results structure, to be loaded with load_results().
+#
+def comparison_results(specs):
+    results = []
+    for spec in specs:
+        label, sep, file = spec.partition('=')
+        if not sep:
+            file = label
+            label = os.path.splitext(os.path.basename(file))[0]
+        if not os.path.exists(file):
+            print('warning: %s not found' % file, file=sys.stderr)
+        results.append({'cpu': label, 'core': '', 'file': os.path.abspath(file)})
+    return results
+
+##
+# Generate a comparison of several results files.
+#
+# The first file is the reference. The operations per second are displayed,
+# followed by the relative difference of each file with the reference.
+#
+# @param [in] results Table results, as returned by comparison_results() and load_results().
+# @param [in] algos List of algorithms to display.
+# @param [in] file Output file handler.
+# @param [in] colsep Separator between columns.
+#
+def display_comparison(results, algos, file, colsep=SEPARATOR):
+    headers = {'cpu': 'Run', 'openssl': 'OpenSSL'}
+    for algo in algos:
+        for op in OP_NAMES:
+            for res in results:
+                if op in res['data'][algo]:
+                    ref = results[0]['data'][algo][op]['oprate']['value'] if op in results[0]['data'][algo] else 0.0
+                    value = res['data'][algo][op]['oprate']['value']
+                    ratio = 100.0 * (value - ref) / ref if ref > 0 and value > 0 else 0.0
+                    string = ('%+.1f%%' % ratio) if ref > 0 and value > 0 else ''
+                    res['data'][algo][op]['ratio'] = {'value': ratio, 'string': string, 'rank': 0}
+    print('CRYPTOGRAPHIC OPERATIONS PER SECOND', file=file)
+    print('', file=file)
+    display_one_table(results, algos, headers, 'oprate', file, colsep)
+    print('', file=file)
+    print('DIFFERENCE WITH %s' % results[0]['cpu'], file=file)
+    print('', file=file)
+    display_one_table(results, algos, headers, 'ratio', file, colsep)
+    energy = energy_results(results, algos)
+    if len(energy) > 0:
+        print('', file=file)
+        print('CRYPTOGRAPHIC OPERATIONS PER JOULE', file=file)
+        print('', file=file)
+        display_one_table(energy, algos, headers, 'opjoule', file, colsep)
+
+##
+# Get the host metadata of a results file.
+#
+# @param [in] file Name of the results file.
+# @return A dictionary of host-xxx values, indexed by xxx. Empty for legacy files.
+#
+def file_metadata(file):
+    meta = {}
+    with open(file, 'r') as input:
+        for line in input:
+            name, sep, value = [field.strip() for field in line.partition(':')]
+            if name == 'algo':
+                break
+            elif sep and name.startswith('host-'):
+                meta[name[5:]] = value
+    return meta
+
+##
+# Build a short CPU name from the model name of the host.
+#
+# @param [in] model CPU model name, e.g. 'Intel(R) Xeon(R) Gold 6348 CPU @ 2.60GHz'.
+# @return Short name, e.g. 'Xeon Gold 6348'.
+#
+def short_cpu_name(model):
+    name = re.sub(r'\((R|TM|tm)\)', '', model)
+    name = re.sub(r'(@| w/ ).*$', '', name)
+    name = re.sub(r'\bCore (?=i[3579]-)', '', name)
+    name = re.sub(r'\b(Intel|AMD|CPU|Processor|[0-9]+-Core|with .*)\b', '', name)
+    return ' '.join(name.split())
+
+##
+# Discover and describe all results files in a directory.
+#
+# Files with host metadata are described from it. Legacy files use the
+# description from RESULTS. Other files are described by their name.
+#
+# @param [in] input_dir Directory of results files.
+# @return A "results" structure, to be loaded with load_results().
+#
+def discover_results(input_dir):
+    legacy = {res['file']: res for res in RESULTS}
+    files = [res['file'] for res in RESULTS]
+    files += sorted([f for f in os.listdir(input_dir) if f.endswith('.txt') and f not in legacy])
+    results = []
+    for file in files:
+        path = input_dir + os.path.sep + file
+        if not os.path.exists(path):
+            print('warning: %s not found' % path, file=sys.stderr)
+            continue
+        with open(path, 'r') as input:
+            if not any(line.startswith('algo:') for line in input):
+                continue
+        meta = file_metadata(path)
+        res = dict(legacy[file]) if file in legacy else {'cpu': '', 'core': '', 'file': file}
+        if 'cpu' in meta:
+            res['cpu'] = short_cpu_name(meta['cpu'])
+            res['host'] = meta
+            if 'max-mhz' in meta and float(meta['max-mhz']) > 0:
+                res['frequency'] = float(meta['max-mhz']) / 1000.0
+            if meta.get('virtualized', '') == 'yes' and not res['core']:
+                res['core'] = 'VM'
+        elif file not in legacy:
+            print('warning: %s has no host description' % file, file=sys.stderr)
+            res['cpu'] = os.path.splitext(file)[0]
+        results.append(res)
+    return results
+
+##
+# Get the throughput samples of all tests in a results file.
+#
+# There is one sample per test, the number of operations per second. With --series
+# or --soak, this is the steady-state rate. The rates of the intervals are not used
+# as samples: the consecutive intervals of one execution are correlated and share
+# the noise of the execution (memory layout, frequency), which is precisely what
+# differs between two executions.
+#
+# @param [in] file Name of the results file.
+# @return A tuple (openssl, tests). The tests are a dictionary of lists of
+# samples, indexed by 'algo op'.
+#
+def file_samples(file):
+    openssl = ''
+    tests = {}
+    steady = {}
+    algo = None
+    microsec = 0.0
+    with open(file, 'r') as input:
+        for line in input:
+            name, sep, value = [field.strip() for field in line.partition(':')]
+            if not sep:
+                continue
+            if name == 'openssl' and not openssl:
+                match = re.search(r'([0-9\.]+[a-zA-Z]*)', value)
+                openssl = match.group(1) if match is not None else ''
+            elif name == 'algo':
+                algo = value
+            elif algo is not None and name.endswith('-microsec'):
+                microsec = float(value)
+            elif algo is not None and name.endswith('-count') and microsec > 0:
+                tests[algo + ' ' + name[:-6]] = [REF_SECONDS * 1000000 * float(value) / microsec]
+            elif algo is not None and name.endswith('-series-steady-rate') and float(value) > 0:
+                steady[algo + ' ' + name[:-19]] = [float(value)]
+    tests.update(steady)
+    return (openssl, tests)
+
+##
+# Append a run to the history file.
+#
+# Several files of the same run (repeated executions) are merged, their
+# samples are accumulated.
+#
+# @param [in] files List of results files of the run.
+# @param [in] history Name of the history file.
+# @param [in] label Label of the run, e.g. 'baseline'.
+# @param [in] host Name of the host. Default: local host name.
+# @return The recorded run.
+#
+def record_run(files, history, label='', host=''):
+    if not host and len(files) > 0:
+        host = file_metadata(files[0]).get('name', '')
+    run = {'time': datetime.datetime.now().isoformat(timespec='seconds'),
+           'host': host if host else socket.gethostname(),
+           'label': label, 'openssl': '', 'files': [], 'tests': {}}
+    for file in files:
+        openssl, tests = file_samples(file)
+        run['openssl'] = run['openssl'] if run['openssl'] else openssl
+        run['files'].append(os.path.basename(file))
+        for test in tests:
+            run['tests'][test] = run['tests'].get(test, []) + tests[test]
+    with open(history, 'a') as output:
+        print(json.dumps(run, sort_keys=True), file=output)
+    return run
+
+##
+# Load the runs of one host from the history file.
+#
+# @param [in] history Name of the history file.
+# @param [in] host Name of the host. Empty: all hosts.
+# @return The list of runs, in order of recording.
+#
+def load_history(history, host=''):
+    runs = []
+    if os.path.exists(history):
+        with open(history, 'r') as input:
+            for line in input:
+                if line.strip():
+                    run = json.loads(line)
+                    if not host or run['host'] == host:
+                        runs.append(run)
+    return runs
+
+##
+# Find a run in a list of runs.
+#
+# @param [in] runs List of runs.
+# @param [in] spec Index in the list (negative from the end) or label (last run with it).
+# @return The run or None.
+#
+def find_run(runs, spec):
+    if re.fullmatch(r'-?[0-9]+', spec):
+        index = int(spec)
+        return runs[index] if -len(runs) <= index < len(runs) else None
+    matches = [run for run in runs if run['label'] == spec]
+    return matches[-1] if len(matches) > 0 else None
+
+##
+# Regularized incomplete beta function I_x(a,b).
+#
+# Continued fraction evaluation, from "Numerical Recipes", section 6.4.
+#
+def incomplete_beta(x, a, b):
+    if x <= 0.0:
+        return 0.0
+    if x >= 1.0:
+        return 1.0
+    front = math.exp(math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b) + a * math.log(x) + b * math.log(1.0 - x))
+    # The continued fraction converges faster on the other side of the symmetry.
+    if x > (a + 1.0) / (a + b + 2.0):
+        return 1.0 - incomplete_beta(1.0 - x, b, a)
+    tiny = 1.0e-300
+    c = 1.0
+    d = 1.0 - (a + b) * x / (a + 1.0)
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    f = d
+    for m in range(1, 300):
+        for numerator in (m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m)),
+                          -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1))):
+            d = 1.0 + numerator * d
+            d = 1.0 / (d if abs(d) > tiny else tiny)
+            c = 1.0 + numerator / c
+            c = c if abs(c) > tiny else tiny
+            f *= c * d
+        if abs(c * d - 1.0) < 1.0e-12:
+            break
+    return front * f / a
+
+##
+# Welch's t-test on two lists of samples.
+#
+# @param [in] s1 First list of samples.
+# @param [in] s2 Second list of samples.
+# @return The two-sided p-value or None when there are not enough samples.
+#
+def welch_test(s1, s2):
+    n1, n2 = len(s1), len(s2)
+    if n1 < 2 or n2 < 2:
+        return None
+    m1, m2 = sum(s1) / n1, sum(s2) / n2
+    v1 = sum([(x - m1) ** 2 for x in s1]) / (n1 - 1)
+    v2 = sum([(x - m2) ** 2 for x in s2]) / (n2 - 1)
+    se2 = v1 / n1 + v2 / n2
+    if se2 <= 0.0:
+        return 1.0 if m1 == m2 else 0.0
+    t = (m1 - m2) / math.sqrt(se2)
+    df = se2 ** 2 / ((v1 / n1) ** 2 / (n1 - 1) + (v2 / n2) ** 2 / (n2 - 1))
+    return incomplete_beta(df / (df + t * t), df / 2.0, 0.5)
+
+##
+# Compare two runs of the history.
+#
+# @param [in] ref Reference run.
+# @param [in] new New run.
+# @param [in] file Output file handler.
+# @param [in] colsep Separator between columns.
+# @return The number of significant regressions. The tests with less than 2 samples
+# in one of the runs cannot be tested and are never reported as regressions.
+#
+def display_history_comparison(ref, new, file, colsep=SEPARATOR):
+    describe = lambda run: '%s %s, OpenSSL %s%s' % (run['host'], run['time'], run['openssl'], (', ' + run['label']) if run['label'] else '')
+    print('Reference: %s' % describe(ref), file=file)
+    print('New:       %s' % describe(new), file=file)
+    print('', file=file)
+    lines = [['Test', 'Reference', 'New', 'Difference', 'p-value', 'Samples', '']]
+    regressions = 0
+    untested = 0
+    for test in [t for t in ref['tests'] if t in new['tests']]:
+        s1, s2 = ref['tests'][test], new['tests'][test]
+        m1, m2 = sum(s1) / len(s1), sum(s2) / len(s2)
+        diff = 100.0 * (m2 - m1) / m1 if m1 > 0 else 0.0
+        p = welch_test(s1, s2)
+        verdict = ''
+        if p is None:
+            verdict = 'not tested (n<2)'
+            untested += 1
+        elif p < SIGNIFICANCE and abs(diff) >= MIN_DIFFERENCE:
+            verdict = 'REGRESSION' if diff < 0 else 'improvement'
+            regressions += 1 if diff < 0 else 0
+        lines.append([test, format_num(m1), format_num(m2), '%+.1f%%' % diff,
+                      'n/a' if p is None else '%.4f' % p, '%d/%d' % (len(s1), len(s2)), verdict])
+    widths = [max([len(line[i]) for line in lines]) for i in range(len(lines[0]))]
+    lines.insert(1, [w * '-' for w in widths])
+    for line in lines:
+        print((line[0].ljust(widths[0]) + ''.join([colsep + line[i].rjust(widths[i]) for i in range(1, len(line))])).rstrip(), file=file)
+    print('', file=file)
+    print('%d significant regression(s), p < %g, difference >= %g%%' % (regressions, SIGNIFICANCE, MIN_DIFFERENCE), file=file)
+    if untested > 0:
+        print('%d test(s) not tested, less than 2 samples in a run: record several files of repeated executions' % untested, file=file)
+    return regressions
+
+##
+# Extract an option with a value from the command line.
+#
+# @param [in,out] args List of arguments. The option and its value are removed.
+# @param [in] name Option name.
+# @param [in] default Default value.
+# @return The option value.
+#
+def option_value(args, name, default=''):
+    if name in args:
+        index = args.index(name)
+        if index + 1 < len(args):
+            value = args[index + 1]
+            del args[index:index + 2]
+            return value
+    return default
+
+##
+# Format a number for a chart axis or label.
+#
+def chart_num(value):
+    return format_num(value) if value < 1.0e6 else '%.3gM' % (value / 1.0e6)
+
+##
+# Generate an SVG horizontal bar chart.
+#
+# @param [in] title Chart title.
+# @param [in] bars List of (label, value) tuples.
+# @return SVG as a string.
+#
+def svg_bar_chart(title, bars):
+    bar_height, chart_width = 18, 420
+    label_width = 10 + int(6.5 * max([len(label) for label, value in bars] + [1]))
+    height = 30 + bar_height * len(bars) + 10
+    vmax = max([value for label, value in bars] + [1.0e-9])
+    svg = ['<svg xmlns="http://www.w3.org/2000/svg" width="%d" height="%d" font-family="sans-serif" font-size="11">' %
+           (label_width + chart_width + 80, height)]
+    svg.append('<text x="0" y="15" font-size="13" font-weight="bold">%s</text>' % html.escape(title))
+    for i, (label, value) in enumerate(bars):
+        y = 30 + i * bar_height
+        width = max(1, int(chart_width * value / vmax))
+        svg.append('<text x="%d" y="%d" text-anchor="end">%s</text>' % (label_width - 5, y + bar_height - 5, html.escape(label)))
+        svg.append('<rect x="%d" y="%d" width="%d" height="%d" fill="%s"/>' % (label_width, y + 2, width, bar_height - 4, COLORS[0]))
+        svg.append('<text x="%d" y="%d">%s</text>' % (label_width + width + 4, y + bar_height - 5, chart_num(value)))
+    svg.append('</svg>')
+    return '\n'.join(svg)
+
+##
+# Generate an SVG line chart with a logarithmic Y axis.
+#
+# @param [in] title Chart title.
+# @param [in] xlabels Labels of the X axis.
+# @param [in] lines List of (name, values) tuples, one value per X label, zero when missing.
+# @return SVG as a string.
+#
+def svg_line_chart(title, xlabels, lines):
+    left, top, width, height, legend = 70, 30, 360, 240, 180
+    values = [v for name, vals in lines for v in vals if v > 0]
+    if len(values) == 0:
+        return ''
+    lmin, lmax = math.floor(math.log10(min(values))), math.ceil(math.log10(max(values)))
+    lmax = lmax if lmax > lmin else lmin + 1
+    xpos = lambda i: left + (width * i / max(1, len(xlabels) - 1))
+    ypos = lambda v: top + height - height * (math.log10(v) - lmin) / (lmax - lmin)
+    svg = ['<svg xmlns="http://www.w3.org/2000/svg" width="%d" height="%d" font-family="sans-serif" font-size="11">' %
+           (left + width + legend, max(top + height + 40, top + 15 * len(lines) + 10))]
+    svg.append('<text x="0" y="15" font-size="13" font-weight="bold">%s</text>' % html.escape(title))
+    for p in range(lmin, lmax + 1):
+        y = ypos(10 ** p)
+        svg.append('<line x1="%d" y1="%.1f" x2="%d" y2="%.1f" stroke="#ddd"/>' % (left, y, left + width, y))
+        svg.append('<text x="%d" y="%.1f" text-anchor="end">%s</text>' % (left - 5, y + 4, chart_num(10 ** p)))
+    for i, label in enumerate(xlabels):
+        svg.append('<text x="%.1f" y="%d" text-anchor="middle">%s</text>' % (xpos(i), top + height + 18, html.escape(label)))
+    for n, (name, vals) in enumerate(lines):
+        color = COLORS[n % len(COLORS)]
+        points = ['%.1f,%.1f' % (xpos(i), ypos(v)) for i, v in enumerate(vals) if v > 0]
+        svg.append('<polyline points="%s" fill="none" stroke="%s" stroke-width="2"/>' % (' '.join(points), color))
+        for pt in points:
+            x, y = pt.split(',')
+            svg.append('<circle cx="%s" cy="%s" r="3" fill="%s"/>' % (x, y, color))
+        svg.append('<rect x="%d" y="%d" width="10" height="10" fill="%s"/>' % (left + width + 15, top + n * 15, color))
+        svg.append('<text x="%d" y="%d">%s</text>' % (left + width + 30, top + n * 15 + 9, html.escape(name)))
+    svg.append('</svg>')
+    return '\n'.join(svg)
+
+##
+# Generate an HTML report with SVG charts.
+#
+# One bar chart per value, algorithm and operation, comparing the CPU's.
+# Then one chart per operation with the key size scaling curve of each CPU.
+#
+# @param [in] results Table results.
+# @param [in] algos List of algorithms to display.
+# @param [in] file Output file handler.
+#
+def html_report(results, algos, file):
+    name = lambda res: res['cpu'] + (' (' + res['core'] + ')' if res['core'] else '')
+    print('<!DOCTYPE html>\n<html>\n<head>\n<meta charset="utf-8">\n<title>rsabench results</title>', file=file)
+    print('<style>body {font-family: sans-serif;} svg {margin: 10px;}</style>\n</head>\n<body>', file=file)
+    print('<h1>RSA performance</h1>', file=file)
+    print('<p>%s</p>' % html.escape(', '.join(['%s: OpenSSL %s, %s' % (name(res), res['openssl'], res['freq']) for res in results])), file=file)
+    for value in CHART_TITLES:
+        print('<h2>%s</h2>' % html.escape(CHART_TITLES[value]), file=file)
+        for algo in algos:
+            for op in OP_NAMES:
+                bars = [(name(res), res['data'][algo][op][value]['value']) for res in results
+                        if algo in res['data'] and op in res['data'][algo] and res['data'][algo][op][value]['value'] > 0]
+                if len(bars) > 0:
+                    print(svg_bar_chart('%s %s' % (algo, op), bars), file=file)
+    # Key size scaling, on the RSA algorithms which differ only by key size.
+    sizes = sorted([(int(m.group(1)), algo) for algo in algos for m in [re.fullmatch(r'RSA-([0-9]+)', algo)] if m is not None])
+    if len(sizes) > 1:
+        print('<h2>Key size scaling (operations per second)</h2>', file=file)
+        for op in OP_NAMES:
+            lines = []
+            for res in results:
+                vals = [res['data'][algo][op]['oprate']['value'] if algo in res['data'] and op in res['data'][algo] else 0.0
+                        for bits, algo in sizes]
+                if any(v > 0 for v in vals):
+                    lines.append((name(res), vals))
+            if len(lines) > 0:
+                print(svg_line_chart(op, [str(bits) for bits, algo in sizes], lines), file=file)
+    print('</body>\n</html>', file=file)
 
 #
 # Main code.
 #
 if __name__ == '__main__':
     dir = os.path.dirname(os.path.abspath(__file__))
-    algos = load_results(RESULTS, dir + '/results')
+    if '--help' in sys.argv:
+        with open(os.path.abspath(__file__), 'r') as input:
+            lines = input.readlines()
+        for line in lines[4:lines.index('#' + 76 * '-' + '\n', 2)]:
+            print(line[2:].rstrip())
+        exit(0)
+    if '--record' in sys.argv or '--compare-history' in sys.argv:
+        args = sys.argv[1:]
+        history = option_value(args, '--history', dir + '/' + HISTORY_FILE)
+        host = option_value(args, '--host')
+        label = option_value(args, '--label')
+        if args[0] == '--record':
+            if len(args) < 2:
+                print('usage: %s --record [--history file] [--host name] [--label text] file ...' % sys.argv[0], file=sys.stderr)
+                exit(1)
+            run = record_run(args[1:], history, label, host)
+            print('recorded %d tests for %s in %s' % (len(run['tests']), run['host'], history))
+            exit(0)
+        # Default: compare the last run of the host with the last 'baseline' run or the previous run.
+        runs = load_history(history, host if host else socket.gethostname())
+        specs = args[1:]
+        if len(specs) == 0:
+            specs = ['baseline' if find_run(runs[:-1], 'baseline') is not None else '-2']
+        if len(specs) == 1:
+            specs.append('-1')
+        ref, new = find_run(runs, specs[0]), find_run(runs, specs[1])
+        if ref is None or new is None:
+            print('usage: %s --compare-history [--history file] [--host name] [ref [new]]' % sys.argv[0], file=sys.stderr)
+            print('each run needs at least 2 samples per test: record several files of repeated executions', file=sys.stderr)
+            print('error: run %s not found in %s' % (specs[0] if ref is None else specs[1], history), file=sys.stderr)
+            exit(1)
+        exit(1 if display_history_comparison(ref, new, sys.stdout) > 0 else 0)
+    if '--compare' in sys.argv:
+        specs = sys.argv[sys.argv.index('--compare') + 1:]
+        if len(specs) == 0:
+            print('usage: %s --compare [label=]file ...' % sys.argv[0], file=sys.stderr)
+            exit(1)
+        results = comparison_results(specs)
+        algos = load_results(results, os.getcwd())
+        display_comparison(results, algos, sys.stdout)
+        exit(0)
+    results = discover_results(dir + '/results')
+    algos = load_results(results, dir + '/results')
     if '--pprint' in sys.argv:
-        pprint.pprint(RESULTS, width=132)
+        pprint.pprint(results, width=132)
     else:
         with open(dir + '/RESULTS.txt', 'w') as output:
-            display_tables(RESULTS, algos, HEADERS, output)
+            display_tables(results, algos, HEADERS, output)
+        if '--html' in sys.argv:
+            args = sys.argv[1:]
+            with open(option_value(args, '--html', dir + '/RESULTS.html'), 'w') as output:
+                html_report(results, algos, output)
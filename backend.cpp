@@ -0,0 +1,191 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Crypto backends: the libraries which implement the RSA operations.
+//
+// OpenSSL is always available. Only OpenSSL 3.x is supported, BoringSSL
+// and AWS-LC lack some of the OpenSSL 3 API's which are used here.
+// The other backends are compiled when their library is found by the
+// makefile. Each backend loads the same key pairs from the keys directory.
+//
+// To get directly comparable numbers, all backends use the same paddings
+// as the OpenSSL backend: OAEP with SHA-1 (the OpenSSL default) and PSS
+// with the same hash as OpenSSL. The PSS salt length may differ, its cost
+// is negligible compared to the modular exponentiation.
+//
+//----------------------------------------------------------------------------
+
+// Low-level padding functions are deprecated but still the only way to pad without RSA operation.
+#define OPENSSL_SUPPRESS_DEPRECATED 1
+
+#include "rsabench.h"
+#include <algorithm>
+#include <memory>
+#include <cstdio>
+#include <openssl/rsa.h>
+
+
+//----------------------------------------------------------------------------
+// OpenSSL backend.
+//----------------------------------------------------------------------------
+
+namespace {
+    class OpenSSLBackend : public Backend
+    {
+    public:
+        virtual std::string name() const override
+        {
+            return "openssl";
+        }
+        virtual std::string version() const override
+        {
+            return OpenSSL_version(OPENSSL_VERSION);
+        }
+        virtual BackendOperation* new_operation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash) override
+        {
+            return new RSAOperation(keys, type, pss_hash);
+        }
+    };
+}
+
+
+//----------------------------------------------------------------------------
+// List of backends which are compiled in, created once.
+//----------------------------------------------------------------------------
+
+static const std::vector<std::unique_ptr<Backend>>& all_backends()
+{
+    static const std::vector<std::unique_ptr<Backend>> backends([]() {
+        std::vector<std::unique_ptr<Backend>> list;
+        list.emplace_back(new OpenSSLBackend);
+#if defined(HAVE_GCRYPT)
+        list.emplace_back(new_gcrypt_backend());
+#endif
+#if defined(HAVE_NETTLE)
+        list.emplace_back(new_nettle_backend());
+#endif
+#if defined(HAVE_MBEDTLS)
+        list.emplace_back(new_mbedtls_backend());
+#endif
+#if defined(HAVE_GMP)
+        list.emplace_back(new_gmp_backend());
+#endif
+        for (auto backend : new_mont_backends()) {
+            list.emplace_back(backend);
+        }
+        return list;
+    }());
+    return backends;
+}
+
+std::vector<std::string> backend_names()
+{
+    std::vector<std::string> names;
+    for (const auto& backend : all_backends()) {
+        names.push_back(backend->name());
+    }
+    return names;
+}
+
+Backend& get_backend(const std::string& name)
+{
+    for (const auto& backend : all_backends()) {
+        if (backend->name() == name) {
+            return *backend;
+        }
+    }
+    std::cerr << "rsabench: backend '" << name << "' is not available, use one of:";
+    for (const auto& backend : all_backends()) {
+        std::cerr << " " << backend->name();
+    }
+    std::cerr << std::endl;
+    std::exit(EXIT_FAILURE);
+}
+
+Backend& current_backend()
+{
+    return get_backend(opt.backends.empty() ? "openssl" : opt.backends.front());
+}
+
+
+//----------------------------------------------------------------------------
+// Run the tests of all specified backends in child processes and compare them.
+//----------------------------------------------------------------------------
+
+void backend_tests()
+{
+    std::vector<ChildResult> results;
+    for (const auto& name : opt.backends) {
+        std::cout << "backend-version: " << name << ", " << get_backend(name).version() << std::endl;
+        std::vector<std::string> args(opt.child_args);
+        args.push_back("--backend");
+        args.push_back(name);
+        std::cerr << "rsabench: running backend " << name << std::endl;
+        results.push_back(run_child(args, {}));
+        if (!results.back().success) {
+            std::cerr << "rsabench: test failed with backend " << name << std::endl << results.back().output;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    std::cout << std::endl << "CRYPTO BACKENDS" << std::endl << std::endl;
+    print_comparison(opt.backends, results, false);
+}
+
+
+//----------------------------------------------------------------------------
+// Raw modular exponentiation backends, with OpenSSL paddings.
+//----------------------------------------------------------------------------
+
+RawOperation::RawOperation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash) :
+    BackendOperation(type),
+    _keys(keys),
+    _md(pss_hash),
+    _padded(keys.size())
+{
+    init_plain(keys.size(), pss_hash);
+}
+
+void RawOperation::init()
+{
+    init_input(_keys.size());
+}
+
+void RawOperation::run()
+{
+    const int key_size = int(_keys.size());
+    const RSA* rsa = EVP_PKEY_get0_RSA(_keys.priv());
+    int len = 0;
+
+    switch (_type) {
+        case OAEP_ENCRYPT:
+            if (RSA_padding_add_PKCS1_OAEP_mgf1(_padded.data(), key_size, _input.data(), int(_input.size()), nullptr, 0, nullptr, nullptr) <= 0) {
+                fatal("OAEP padding error");
+            }
+            raw_public(_padded.data(), _output.data());
+            _output_len = key_size;
+            break;
+        case OAEP_DECRYPT:
+            raw_private(_input.data(), _padded.data());
+            len = RSA_padding_check_PKCS1_OAEP_mgf1(_output.data(), int(_output.size()), _padded.data(), key_size, key_size, nullptr, 0, nullptr, nullptr);
+            if (len < 0) {
+                fatal("OAEP padding check error");
+            }
+            _output_len = size_t(len);
+            break;
+        case PSS_SIGN:
+            if (RSA_padding_add_PKCS1_PSS_mgf1(const_cast<RSA*>(rsa), _padded.data(), _input.data(), _md, _md, RSA_PSS_SALTLEN_MAX) <= 0) {
+                fatal("PSS padding error");
+            }
+            raw_private(_padded.data(), _output.data());
+            _output_len = key_size;
+            break;
+        case PSS_VERIFY:
+            raw_public(_input.data(), _padded.data());
+            if (RSA_verify_PKCS1_PSS_mgf1(const_cast<RSA*>(rsa), _plain.data(), _md, _md, _padded.data(), RSA_PSS_SALTLEN_AUTO) <= 0) {
+                fatal("RSA verify error");
+            }
+            break;
+    }
+}
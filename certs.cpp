@@ -0,0 +1,71 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// X.509 certificates, created in memory from the key pairs.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <openssl/x509v3.h>
+
+
+//----------------------------------------------------------------------------
+// Add an extension to a certificate. Abort on error.
+//----------------------------------------------------------------------------
+
+static void add_extension(X509* cert, X509* issuer, int nid, const std::string& value)
+{
+    X509V3_CTX ctx;
+    X509V3_set_ctx_nodb(&ctx);
+    X509V3_set_ctx(&ctx, issuer, cert, nullptr, nullptr, 0);
+    X509_EXTENSION* ext = X509V3_EXT_conf_nid(nullptr, &ctx, nid, value.c_str());
+    if (ext == nullptr || !X509_add_ext(cert, ext, -1)) {
+        fatal("error adding certificate extension " + value);
+    }
+    X509_EXTENSION_free(ext);
+}
+
+
+//----------------------------------------------------------------------------
+// Create a certificate for a public key, signed by an issuer.
+//----------------------------------------------------------------------------
+
+X509* new_certificate(const std::string& name, EVP_PKEY* key, EVP_PKEY* issuer_key, X509* issuer, bool ca)
+{
+    static long serial = 0;
+    X509* cert = X509_new();
+    X509_NAME* subject = X509_NAME_new();
+    if (cert == nullptr ||
+        subject == nullptr ||
+        !X509_set_version(cert, X509_VERSION_3) ||
+        !ASN1_INTEGER_set(X509_get_serialNumber(cert), ++serial) ||
+        X509_gmtime_adj(X509_getm_notBefore(cert), -86400) == nullptr ||
+        X509_gmtime_adj(X509_getm_notAfter(cert), 365 * 86400) == nullptr ||
+        !X509_NAME_add_entry_by_txt(subject, "O", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("rsabench"), -1, -1, 0) ||
+        !X509_NAME_add_entry_by_txt(subject, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>(name.c_str()), -1, -1, 0) ||
+        !X509_set_subject_name(cert, subject) ||
+        !X509_set_issuer_name(cert, issuer == nullptr ? subject : X509_get_subject_name(issuer)) ||
+        !X509_set_pubkey(cert, key))
+    {
+        fatal("error creating certificate " + name);
+    }
+    X509_NAME_free(subject);
+
+    // Self-signed: the certificate is its own issuer for the authority key identifier.
+    X509* signer = issuer == nullptr ? cert : issuer;
+    add_extension(cert, signer, NID_basic_constraints, ca ? "critical,CA:TRUE" : "critical,CA:FALSE");
+    add_extension(cert, signer, NID_key_usage, ca ? "critical,keyCertSign,cRLSign" : "critical,digitalSignature,keyEncipherment");
+    add_extension(cert, signer, NID_subject_key_identifier, "hash");
+    add_extension(cert, signer, NID_authority_key_identifier, "keyid:always");
+    if (!ca) {
+        add_extension(cert, signer, NID_ext_key_usage, "serverAuth,clientAuth");
+        add_extension(cert, signer, NID_subject_alt_name, "DNS:" + name);
+    }
+
+    if (X509_sign(cert, issuer_key == nullptr ? key : issuer_key, EVP_sha256()) <= 0) {
+        fatal("error signing certificate " + name);
+    }
+    return cert;
+}
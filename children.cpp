@@ -0,0 +1,288 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Run rsabench in child processes and compare their results.
+//
+// Some parameters cannot change inside a process, such as the malloc
+// implementation. The corresponding tests re-execute rsabench in child
+// processes with a modified environment and compare their throughput.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <algorithm>
+#include <filesystem>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#if defined(__APPLE__)
+    #define PRELOAD_VAR  "DYLD_INSERT_LIBRARIES"
+    #define SHLIB_SUFFIX ".dylib"
+#else
+    #define PRELOAD_VAR  "LD_PRELOAD"
+    #define SHLIB_SUFFIX ".so"
+#endif
+
+
+//----------------------------------------------------------------------------
+// Run rsabench in a child process with additional environment variables.
+//----------------------------------------------------------------------------
+
+ChildResult run_child(const std::vector<std::string>& args, const std::vector<std::pair<std::string, std::string>>& env)
+{
+    ChildResult result;
+    const std::string exe(current_exec());
+
+    int fds[2];
+    if (::pipe(fds) < 0) {
+        perror("pipe");
+        std::exit(EXIT_FAILURE);
+    }
+    std::cout.flush();
+    std::fflush(stdout);
+    const pid_t pid = ::fork();
+    if (pid < 0) {
+        perror("fork");
+        std::exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        // Child process, the standard output is the pipe.
+        ::close(fds[0]);
+        ::dup2(fds[1], STDOUT_FILENO);
+        ::close(fds[1]);
+        for (const auto& var : env) {
+            ::setenv(var.first.c_str(), var.second.c_str(), 1);
+        }
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(exe.c_str()));
+        for (const auto& arg : args) {
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        argv.push_back(nullptr);
+        ::execv(exe.c_str(), argv.data());
+        perror(exe.c_str());
+        ::_exit(EXIT_FAILURE);
+    }
+
+    // Parent process, read the complete output of the child.
+    ::close(fds[1]);
+    char buffer[4096];
+    for (;;) {
+        const ssize_t n = ::read(fds[0], buffer, sizeof(buffer));
+        if (n > 0) {
+            result.output.append(buffer, size_t(n));
+        }
+        else if (n == 0 || errno != EINTR) {
+            break;
+        }
+    }
+    ::close(fds[0]);
+
+    int status = 0;
+    rusage ru;
+    std::memset(&ru, 0, sizeof(ru));
+    while (::wait4(pid, &status, 0, &ru) < 0 && errno == EINTR) {
+    }
+    result.success = WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+#if defined(__APPLE__)
+    result.max_rss_kb = int64_t(ru.ru_maxrss) / 1024;  // in bytes on macOS
+#else
+    result.max_rss_kb = int64_t(ru.ru_maxrss);
+#endif
+
+    // Collect the operations per second of all tests, named "algo op".
+    std::string algo;
+    size_t start = 0;
+    for (size_t eol = 0; (eol = result.output.find('\n', start)) != std::string::npos; start = eol + 1) {
+        const std::string line(result.output.substr(start, eol - start));
+        const size_t persec = line.find("-persec: ");
+        if (line.compare(0, 6, "algo: ") == 0) {
+            algo = line.substr(6);
+        }
+        else if (!algo.empty() && persec != std::string::npos) {
+            const std::string test(algo + " " + line.substr(0, persec));
+            result.tests.push_back(test);
+            result.persec[test] = std::strtod(line.c_str() + persec + 9, nullptr);
+        }
+    }
+    return result;
+}
+
+
+//----------------------------------------------------------------------------
+// Print a comparison table of the throughput of several child processes.
+//----------------------------------------------------------------------------
+
+void print_comparison(const std::vector<std::string>& titles, const std::vector<ChildResult>& results, bool with_rss)
+{
+    // All test names, in order of appearance. Relative values to the first column.
+    std::vector<std::string> tests;
+    for (const auto& res : results) {
+        for (const auto& test : res.tests) {
+            if (std::find(tests.begin(), tests.end(), test) == tests.end()) {
+                tests.push_back(test);
+            }
+        }
+    }
+
+    // Build all lines first, to compute the column widths.
+    std::vector<std::vector<std::string>> lines;
+    lines.push_back({"op/s"});
+    lines.back().insert(lines.back().end(), titles.begin(), titles.end());
+    for (const auto& test : tests) {
+        lines.push_back({test});
+        const auto ref = results.front().persec.find(test);
+        for (size_t c = 0; c < results.size(); c++) {
+            const auto it = results[c].persec.find(test);
+            char cell[64] = "";
+            if (it == results[c].persec.end()) {
+                std::snprintf(cell, sizeof(cell), "-");
+            }
+            else if (c > 0 && ref != results.front().persec.end() && ref->second > 0.0) {
+                std::snprintf(cell, sizeof(cell), "%.0f (%+.1f%%)", it->second, 100.0 * (it->second / ref->second - 1.0));
+            }
+            else {
+                std::snprintf(cell, sizeof(cell), "%.0f", it->second);
+            }
+            lines.back().push_back(cell);
+        }
+    }
+    if (with_rss) {
+        lines.push_back({"max RSS (kB)"});
+        for (const auto& res : results) {
+            lines.back().push_back(std::to_string(res.max_rss_kb));
+        }
+    }
+
+    print_table(lines);
+}
+
+
+//----------------------------------------------------------------------------
+// Print a table with aligned columns, the first line is the header.
+//----------------------------------------------------------------------------
+
+void print_table(const std::vector<std::vector<std::string>>& lines)
+{
+    std::vector<size_t> widths;
+    for (const auto& line : lines) {
+        widths.resize(std::max(widths.size(), line.size()), 0);
+        for (size_t c = 0; c < line.size(); c++) {
+            widths[c] = std::max(widths[c], line[c].size());
+        }
+    }
+    for (size_t l = 0; l < lines.size(); l++) {
+        for (size_t c = 0; c < lines[l].size(); c++) {
+            std::printf(c == 0 ? "%-*s" : "   %*s", int(widths[c]), lines[l][c].c_str());
+        }
+        std::printf("\n");
+        if (l == 0) {
+            for (size_t c = 0; c < widths.size(); c++) {
+                std::printf(c == 0 ? "%s" : "   %s", std::string(widths[c], '-').c_str());
+            }
+            std::printf("\n");
+        }
+    }
+    std::fflush(stdout);
+}
+
+
+//----------------------------------------------------------------------------
+// Find the alternative malloc libraries which are installed on the system.
+//----------------------------------------------------------------------------
+
+static std::vector<std::pair<std::string, std::string>> find_allocators()
+{
+    static const char* const dirs[] = {
+        "/usr/lib/x86_64-linux-gnu", "/usr/lib/aarch64-linux-gnu", "/usr/lib64", "/usr/lib",
+        "/usr/local/lib", "/opt/homebrew/lib", "/usr/local/opt/jemalloc/lib",
+    };
+    static const std::pair<const char*, std::vector<const char*>> libs[] = {
+        {"jemalloc", {"libjemalloc" SHLIB_SUFFIX ".2", "libjemalloc.2" SHLIB_SUFFIX, "libjemalloc" SHLIB_SUFFIX}},
+        {"tcmalloc", {"libtcmalloc_minimal" SHLIB_SUFFIX ".4", "libtcmalloc" SHLIB_SUFFIX ".4", "libtcmalloc_minimal.4" SHLIB_SUFFIX}},
+        {"mimalloc", {"libmimalloc" SHLIB_SUFFIX ".2", "libmimalloc.2" SHLIB_SUFFIX, "libmimalloc" SHLIB_SUFFIX}},
+    };
+
+    std::vector<std::pair<std::string, std::string>> found;
+    for (const auto& lib : libs) {
+        bool done = false;
+        for (size_t d = 0; !done && d < sizeof(dirs) / sizeof(dirs[0]); d++) {
+            for (size_t f = 0; !done && f < lib.second.size(); f++) {
+                const std::string path(std::string(dirs[d]) + "/" + lib.second[f]);
+                if (std::filesystem::exists(path)) {
+                    found.push_back(std::make_pair(lib.first, path));
+                    done = true;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+
+//----------------------------------------------------------------------------
+// Run all tests with each allocator, at several thread counts.
+//----------------------------------------------------------------------------
+
+void alloc_matrix_tests()
+{
+    // List of allocators: name, preloaded library, additional option.
+    struct Allocator
+    {
+        std::string name;
+        std::string preload;
+        std::string option;
+    };
+    std::vector<Allocator> allocators {{"system", "", ""}, {"pool", "", "--pool-alloc"}};
+    for (const auto& lib : find_allocators()) {
+        allocators.push_back({lib.first, lib.second, ""});
+    }
+
+    std::vector<size_t> threads(opt.threads_list);
+    if (threads.empty()) {
+        threads = {1, cpu_count()};
+    }
+    std::sort(threads.begin(), threads.end());
+    threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+
+    for (const auto& alloc : allocators) {
+        std::cout << "alloc-matrix-allocator: " << alloc.name;
+        if (!alloc.preload.empty()) {
+            std::cout << " (" << alloc.preload << ")";
+        }
+        std::cout << std::endl;
+    }
+
+    for (size_t nthreads : threads) {
+        std::vector<std::string> titles;
+        std::vector<ChildResult> results;
+        for (const auto& alloc : allocators) {
+            std::vector<std::string> args(opt.child_args);
+            args.push_back("--threads");
+            args.push_back(std::to_string(nthreads));
+            if (!alloc.option.empty()) {
+                args.push_back(alloc.option);
+            }
+            std::vector<std::pair<std::string, std::string>> env;
+            if (!alloc.preload.empty()) {
+                env.push_back(std::make_pair(PRELOAD_VAR, alloc.preload));
+            }
+            std::cerr << "rsabench: running " << alloc.name << " with " << nthreads << " threads" << std::endl;
+            results.push_back(run_child(args, env));
+            if (!results.back().success) {
+                std::cerr << "rsabench: test failed with " << alloc.name << std::endl << results.back().output;
+                std::exit(EXIT_FAILURE);
+            }
+            titles.push_back(alloc.name);
+        }
+        std::cout << std::endl << "ALLOCATORS WITH " << nthreads << " THREAD" << (nthreads > 1 ? "S" : "") << std::endl << std::endl;
+        print_comparison(titles, results, true);
+    }
+}
@@ -0,0 +1,107 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Load-generating clients of a local RSA service.
+//
+// The same closed-loop client runs over the various transports: direct
+// in-process calls, Unix socket, shared memory ring. The results use the
+// same format, with the transport name, to compare them.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <algorithm>
+#include <thread>
+#include <cstdio>
+
+
+//----------------------------------------------------------------------------
+// In-process client connection: direct calls, as a reference.
+//----------------------------------------------------------------------------
+
+void inprocess_connection(const RSAKeys& keys, const RSAOperation& op, int64_t end, ClientStats& stats)
+{
+    RSAOperation local(keys, op.type());
+    const std::vector<uint8_t> data(op.request_data());
+    std::vector<uint8_t> output(local.output_capacity());
+
+    while (wall_time_ns() < end) {
+        const int64_t start = wall_time_ns();
+        size_t output_size = output.size();
+        if (!local.process(data.data(), data.size(), output.data(), output_size)) {
+            fatal(std::string("RSA error on ") + op.name());
+        }
+        const int64_t duration = wall_time_ns() - start;
+        stats.latency.push_back(duration);
+        stats.service += duration;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Run client tests on all keys and operations.
+//----------------------------------------------------------------------------
+
+void run_client_tests(const std::string& transport, ClientConnection connection)
+{
+    // Default operations: the private key operations of a signing service.
+    std::vector<std::string> op_names(opt.ops);
+    if (op_names.empty()) {
+        op_names = {op_name(OAEP_DECRYPT), op_name(PSS_SIGN)};
+    }
+
+    std::cout << "client-transport: " << transport << std::endl;
+    std::cout << "client-connections: " << opt.connections << std::endl;
+
+    for (const auto& key_name : opt.keys) {
+        const RSAKeys keys("rsa-" + key_name);
+        std::cout << "algo: " << keys.algo() << std::endl;
+
+        for (const auto& name : op_names) {
+            const RSAOperation op(keys, op_type(name));
+            std::vector<ClientStats> stats(opt.connections);
+            std::vector<std::thread> threads;
+            const int64_t start = wall_time_ns();
+            const int64_t end = start + opt.duration * 1000;
+            for (size_t i = 0; i < opt.connections; i++) {
+                threads.emplace_back(connection, std::cref(keys), std::cref(op), end, std::ref(stats[i]));
+            }
+            for (auto& th : threads) {
+                th.join();
+            }
+            const int64_t elapsed = wall_time_ns() - start;
+
+            // Aggregate statistics.
+            std::vector<int64_t> all;
+            int64_t queue = 0;
+            int64_t service = 0;
+            int64_t batch = 0;
+            for (const auto& st : stats) {
+                all.insert(all.end(), st.latency.begin(), st.latency.end());
+                queue += st.queue;
+                service += st.service;
+                batch += st.batch;
+            }
+            const LatencyStats lat(all);
+            const double count = double(std::max<size_t>(lat.count, 1));
+            const double queue_us = double(queue) / (1000.0 * count);
+            const double service_us = double(service) / (1000.0 * count);
+            const char* const prefix = name.c_str();
+            const char* const tr = transport.c_str();
+
+            std::printf("%s-%s-requests: %zu\n", prefix, tr, lat.count);
+            std::printf("%s-%s-reqpersec: %.0f\n", prefix, tr, double(NSECPERSEC) * lat.count / double(elapsed));
+            std::printf("%s-%s-latency-usec: mean=%.1f p50=%.1f p90=%.1f p99=%.1f p999=%.1f max=%.1f\n",
+                        prefix, tr, lat.mean, lat.p50, lat.p90, lat.p99, lat.p999, lat.max);
+            std::printf("%s-%s-service-usec: %.1f\n", prefix, tr, service_us);
+            std::printf("%s-%s-queue-usec: %.1f\n", prefix, tr, queue_us);
+            std::printf("%s-%s-ipc-usec: %.1f\n", prefix, tr, std::max(0.0, lat.mean - queue_us - service_us));
+            if (batch > 0) {
+                std::printf("%s-%s-mean-batch: %.2f\n", prefix, tr, double(batch) / count);
+            }
+            std::fflush(stdout);
+        }
+    }
+}
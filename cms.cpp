@@ -0,0 +1,181 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// CMS (S/MIME) signing and enveloping of documents.
+//
+// The signer and recipient certificates are created in memory and
+// self-signed by the tested key pair. Each operation includes the DER
+// encoding or decoding of the CMS structure, as in a document pipeline.
+//
+// - sign: signed data with RSA-PSS and SHA-256, attached content.
+// - verify: signature verification only. The signer certificate is not
+//   verified, see the --x509 tests for the chain verification.
+// - encrypt: enveloped data with AES-256-CBC, the content key is
+//   transported to each recipient using RSA-OAEP.
+// - decrypt: by the last recipient, after a search in the recipient list.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <openssl/cms.h>
+#include <openssl/rsa.h>
+
+namespace {
+    // DER encoding of a CMS structure.
+    std::vector<uint8_t> to_der(CMS_ContentInfo* cms)
+    {
+        unsigned char* der = nullptr;
+        const int len = i2d_CMS_ContentInfo(cms, &der);
+        if (len <= 0) {
+            fatal("error encoding CMS structure");
+        }
+        const std::vector<uint8_t> result(der, der + len);
+        OPENSSL_free(der);
+        return result;
+    }
+
+    // Decode a CMS structure from DER.
+    CMS_ContentInfo* from_der(const std::vector<uint8_t>& der)
+    {
+        const unsigned char* p = der.data();
+        CMS_ContentInfo* cms = d2i_CMS_ContentInfo(nullptr, &p, long(der.size()));
+        if (cms == nullptr) {
+            fatal("error decoding CMS structure");
+        }
+        return cms;
+    }
+
+    // Memory BIO over a read-only document.
+    BIO* doc_bio(const std::vector<uint8_t>& doc)
+    {
+        BIO* bio = BIO_new_mem_buf(doc.data(), int(doc.size()));
+        if (bio == nullptr) {
+            fatal("error creating memory BIO");
+        }
+        return bio;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Sign a document with RSA-PSS, return the DER encoding.
+//----------------------------------------------------------------------------
+
+static std::vector<uint8_t> cms_sign(const std::vector<uint8_t>& doc, X509* cert, EVP_PKEY* key)
+{
+    const unsigned int flags = CMS_BINARY | CMS_PARTIAL | CMS_KEY_PARAM;
+    BIO* in = doc_bio(doc);
+    CMS_ContentInfo* cms = CMS_sign(nullptr, nullptr, nullptr, nullptr, flags);
+    CMS_SignerInfo* si = cms == nullptr ? nullptr : CMS_add1_signer(cms, cert, key, EVP_sha256(), flags);
+    EVP_PKEY_CTX* pctx = si == nullptr ? nullptr : CMS_SignerInfo_get0_pkey_ctx(si);
+    if (pctx == nullptr ||
+        EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PSS_PADDING) <= 0 ||
+        EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx, RSA_PSS_SALTLEN_DIGEST) <= 0 ||
+        !CMS_final(cms, in, nullptr, CMS_BINARY))
+    {
+        fatal("CMS signature error");
+    }
+    const std::vector<uint8_t> der(to_der(cms));
+    CMS_ContentInfo_free(cms);
+    BIO_free(in);
+    return der;
+}
+
+
+//----------------------------------------------------------------------------
+// Verify a signed document.
+//----------------------------------------------------------------------------
+
+static void cms_verify(const std::vector<uint8_t>& der, BIO* out)
+{
+    CMS_ContentInfo* cms = from_der(der);
+    if (!CMS_verify(cms, nullptr, nullptr, nullptr, out, CMS_BINARY | CMS_NO_SIGNER_CERT_VERIFY)) {
+        fatal("CMS verification error");
+    }
+    CMS_ContentInfo_free(cms);
+}
+
+
+//----------------------------------------------------------------------------
+// Encrypt a document with RSA-OAEP key transport, return the DER encoding.
+//----------------------------------------------------------------------------
+
+static std::vector<uint8_t> cms_encrypt(const std::vector<uint8_t>& doc, const std::vector<X509*>& certs)
+{
+    const unsigned int flags = CMS_BINARY | CMS_PARTIAL | CMS_KEY_PARAM;
+    BIO* in = doc_bio(doc);
+    CMS_ContentInfo* cms = CMS_encrypt(nullptr, nullptr, EVP_aes_256_cbc(), flags);
+    if (cms == nullptr) {
+        fatal("CMS encryption error");
+    }
+    for (auto* cert : certs) {
+        CMS_RecipientInfo* ri = CMS_add1_recipient_cert(cms, cert, flags);
+        EVP_PKEY_CTX* pctx = ri == nullptr ? nullptr : CMS_RecipientInfo_get0_pkey_ctx(ri);
+        if (pctx == nullptr || EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_OAEP_PADDING) <= 0) {
+            fatal("CMS recipient error");
+        }
+    }
+    if (!CMS_final(cms, in, nullptr, CMS_BINARY)) {
+        fatal("CMS encryption error");
+    }
+    const std::vector<uint8_t> der(to_der(cms));
+    CMS_ContentInfo_free(cms);
+    BIO_free(in);
+    return der;
+}
+
+
+//----------------------------------------------------------------------------
+// Decrypt a document for one recipient.
+//----------------------------------------------------------------------------
+
+static void cms_decrypt(const std::vector<uint8_t>& der, EVP_PKEY* key, X509* cert, BIO* out)
+{
+    CMS_ContentInfo* cms = from_der(der);
+    if (!CMS_decrypt(cms, key, cert, nullptr, out, CMS_BINARY)) {
+        fatal("CMS decryption error");
+    }
+    CMS_ContentInfo_free(cms);
+}
+
+
+//----------------------------------------------------------------------------
+// Run the CMS tests.
+//----------------------------------------------------------------------------
+
+void cms_tests()
+{
+    const std::vector<uint8_t> doc(opt.doc_size, 'x');
+    BIO* out = BIO_new(BIO_s_null());
+
+    for (const auto& key : opt.keys) {
+        const RSAKeys keys("rsa-" + key);
+        std::cout << "algo: " << keys.algo() << std::endl;
+        std::cout << "key-size: " << keys.bits() << std::endl;
+        std::cout << "doc-size: " << doc.size() << std::endl;
+
+        // All recipients use the same key pair, with distinct certificates.
+        std::vector<X509*> certs;
+        for (size_t i = 1; i <= std::max<size_t>(1, opt.recipients); i++) {
+            certs.push_back(new_certificate("user" + std::to_string(i) + ".rsabench.local", keys.priv(), nullptr, nullptr, false));
+        }
+
+        std::vector<uint8_t> der;
+        timed_loop("cms-sign", doc.size(), [&]() { der = cms_sign(doc, certs.front(), keys.priv()); });
+        timed_loop("cms-verify", doc.size(), [&]() { cms_verify(der, out); });
+
+        for (size_t count = 1; count <= certs.size(); count++) {
+            const std::vector<X509*> recipients(certs.begin(), certs.begin() + count);
+            const std::string suffix("-r" + std::to_string(count));
+            timed_loop(("cms-encrypt" + suffix).c_str(), doc.size(), [&]() { der = cms_encrypt(doc, recipients); });
+            timed_loop(("cms-decrypt" + suffix).c_str(), doc.size(), [&]() { cms_decrypt(der, keys.priv(), recipients.back(), out); });
+        }
+
+        for (auto* cert : certs) {
+            X509_free(cert);
+        }
+    }
+    BIO_free(out);
+}
@@ -0,0 +1,237 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// CPU capabilities, as seen and used by OpenSSL.
+//
+// OpenSSL selects its assembly code paths from a capability vector which
+// is initialized from the CPUID instruction (x86) or the hwcaps (Arm).
+// It can be overridden using the environment variables OPENSSL_ia32cap
+// and OPENSSL_armcap, before OpenSSL is initialized. This is done in
+// child processes, to measure the contribution of each extension.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+
+// Bits in the second 64-bit word of OPENSSL_ia32cap (CPUID leaf 7, EBX in low 32 bits).
+#define IA32CAP_BMI2     (uint64_t(1) << 8)
+#define IA32CAP_AVX2     (uint64_t(1) << 5)
+#define IA32CAP_AVX512F  (uint64_t(1) << 16)
+#define IA32CAP_ADX      (uint64_t(1) << 19)
+#define IA32CAP_IFMA     (uint64_t(1) << 21)
+#define IA32CAP_AVX512VL (uint64_t(1) << 31)
+
+// Bits in OPENSSL_armcap.
+#define ARMCAP_NEON      (uint64_t(1) << 0)
+#define ARMCAP_SHA1      (uint64_t(1) << 3)
+#define ARMCAP_SHA256    (uint64_t(1) << 4)
+#define ARMCAP_PMULL     (uint64_t(1) << 5)
+#define ARMCAP_SHA512    (uint64_t(1) << 6)
+
+
+//----------------------------------------------------------------------------
+// Get the capability vector of OpenSSL, from the CPU information string.
+//----------------------------------------------------------------------------
+
+bool openssl_cpu_caps(std::string& name, std::vector<uint64_t>& values)
+{
+    name.clear();
+    values.clear();
+#if defined(OPENSSL_CPU_INFO)
+    // Format: "CPUINFO: OPENSSL_ia32cap=0x...:0x... env:..."
+    const std::string info(OpenSSL_version(OPENSSL_CPU_INFO));
+    const size_t start = info.find("OPENSSL_");
+    const size_t equal = info.find('=', start);
+    if (start == std::string::npos || equal == std::string::npos) {
+        return false;
+    }
+    name = info.substr(start, equal - start);
+    const char* p = info.c_str() + equal + 1;
+    do {
+        char* end = nullptr;
+        values.push_back(std::strtoull(p, &end, 16));
+        if (end == p) {
+            values.pop_back();
+            break;
+        }
+        p = end;
+    } while (*p++ == ':');
+#endif
+    return !name.empty() && !values.empty();
+}
+
+static std::string hex(uint64_t value)
+{
+    std::ostringstream str;
+    str << "0x" << std::hex << value;
+    return str.str();
+}
+
+
+//----------------------------------------------------------------------------
+// Options for a child process which runs the same tests as this process.
+//----------------------------------------------------------------------------
+
+std::vector<std::string> same_test_args()
+{
+    std::vector<std::string> args(opt.child_args);
+    if (opt.threads > 1) {
+        args.push_back("--threads");
+        args.push_back(std::to_string(opt.threads));
+    }
+    if (opt.backends.size() == 1) {
+        args.push_back("--backend");
+        args.push_back(opt.backends.front());
+    }
+    return args;
+}
+
+
+//----------------------------------------------------------------------------
+// Run all tests in child processes with variants of the CPU capabilities.
+//----------------------------------------------------------------------------
+
+namespace {
+    // Name of variant, bits to mask, value of the environment variable (empty: unmodified).
+    struct Variant
+    {
+        std::string name;
+        uint64_t    mask;
+        std::string value;
+    };
+}
+
+static void compare_variants(const std::string& var, const std::vector<Variant>& variants, const std::string& title)
+{
+    std::vector<std::string> titles;
+    std::vector<ChildResult> results;
+    for (const auto& v : variants) {
+        // Skip extensions which are not present on this CPU, same as unmodified.
+        if (!v.value.empty() && v.mask == 0) {
+            std::cout << "isa-sweep-skipped: " << v.name << ", not supported by CPU" << std::endl;
+            continue;
+        }
+        std::cout << "isa-sweep-variant: " << v.name;
+        if (!v.value.empty()) {
+            std::cout << ", " << var << "=" << v.value;
+        }
+        std::cout << std::endl;
+        std::vector<std::pair<std::string, std::string>> env;
+        if (!v.value.empty()) {
+            env.push_back(std::make_pair(var, v.value));
+        }
+        std::cerr << "rsabench: running ISA variant " << v.name << std::endl;
+        results.push_back(run_child(same_test_args(), env));
+        if (!results.back().success) {
+            std::cerr << "rsabench: test failed with ISA variant " << v.name << std::endl << results.back().output;
+            std::exit(EXIT_FAILURE);
+        }
+        titles.push_back(v.name);
+    }
+    std::cout << std::endl << title << std::endl << std::endl;
+    print_comparison(titles, results, false);
+}
+
+
+//----------------------------------------------------------------------------
+// Run all tests with some instruction set extensions masked off.
+//----------------------------------------------------------------------------
+
+void isa_sweep_tests()
+{
+    std::string var;
+    std::vector<uint64_t> caps;
+    if (!openssl_cpu_caps(var, caps)) {
+        fatal("cannot get the CPU capabilities of OpenSSL");
+    }
+
+    std::vector<Variant> variants {{"all", 0, ""}};
+    if (var == "OPENSSL_ia32cap" && caps.size() >= 2) {
+        // The second word can be masked with "~", the first one is left unmodified when empty.
+        for (const auto& v : {Variant{"no-adx-bmi2", IA32CAP_ADX | IA32CAP_BMI2, ""},
+                              Variant{"no-avx2", IA32CAP_AVX2, ""},
+                              Variant{"no-ifma", IA32CAP_IFMA, ""},
+                              Variant{"baseline", IA32CAP_ADX | IA32CAP_BMI2 | IA32CAP_AVX2 | IA32CAP_AVX512F | IA32CAP_IFMA, ""}}) {
+            variants.push_back({v.name, v.mask & caps[1], ":~" + hex(v.mask)});
+        }
+    }
+    else if (var == "OPENSSL_armcap") {
+        // OPENSSL_armcap does not support "~", use the current value without the masked bits.
+        for (const auto& v : {Variant{"no-neon", ARMCAP_NEON, ""},
+                              Variant{"no-sha", ARMCAP_SHA1 | ARMCAP_SHA256 | ARMCAP_SHA512, ""},
+                              Variant{"no-pmull", ARMCAP_PMULL, ""},
+                              Variant{"baseline", ~uint64_t(0), ""}}) {
+            variants.push_back({v.name, v.mask & caps[0], hex(caps[0] & ~v.mask)});
+        }
+    }
+    compare_variants(var, variants, "INSTRUCTION SET EXTENSIONS");
+}
+
+
+//----------------------------------------------------------------------------
+// Compare the AVX-512 IFMA code path of OpenSSL with the same tests without it.
+//----------------------------------------------------------------------------
+
+void ifma_ab_tests()
+{
+    std::string var;
+    std::vector<uint64_t> caps;
+    if (!openssl_cpu_caps(var, caps) || var != "OPENSSL_ia32cap" || caps.size() < 2) {
+        fatal("AVX-512 IFMA comparison is only available on x86 with OpenSSL 3");
+    }
+    const uint64_t ifma = IA32CAP_AVX512F | IA32CAP_IFMA | IA32CAP_AVX512VL;
+    if ((caps[1] & ifma) != ifma) {
+        // Cannot force IFMA on a CPU without it, the code would crash.
+        std::cout << "ifma-ab: AVX-512 IFMA not supported by CPU" << std::endl;
+        return;
+    }
+    compare_variants(var, {{"ifma", 0, ""}, {"no-ifma", IA32CAP_IFMA, ":~" + hex(IA32CAP_IFMA)}}, "AVX-512 IFMA");
+}
+
+
+//----------------------------------------------------------------------------
+// Name of the code path which is used by OpenSSL for the modular
+// exponentiation of an operation. This is a prediction from the CPU
+// capabilities, the OpenSSL version and the key, using the same criteria
+// as OpenSSL. Use --ifma-ab or --isa-sweep to confirm it.
+//----------------------------------------------------------------------------
+
+std::string openssl_code_path(const RSAKeys& keys, RSAOpType type)
+{
+    std::string var;
+    std::vector<uint64_t> caps;
+    if (!openssl_cpu_caps(var, caps)) {
+        return "unknown";
+    }
+    if (var == "OPENSSL_armcap") {
+        return "armv8 (bn_mul_mont)";
+    }
+    if (var != "OPENSSL_ia32cap" || caps.size() < 2) {
+        return "generic";
+    }
+
+    const uint64_t c = caps[1];
+    const bool adx = (c & (IA32CAP_ADX | IA32CAP_BMI2)) == (IA32CAP_ADX | IA32CAP_BMI2);
+    if (type == OAEP_DECRYPT || type == PSS_SIGN) {
+        // CRT private operation: ossl_bn_mod_exp_mont_consttime_x2() on the two factors.
+        const RSAKeyComponents comp(key_components(keys));
+        const size_t pbits = bit_length(comp.p);
+        const size_t qbits = bit_length(comp.q);
+        const uint64_t ifma = IA32CAP_AVX512F | IA32CAP_IFMA | IA32CAP_AVX512VL;
+        // OpenSSL 3.0 supports 1024-bit factors (RSA-2048), 3.1 adds 1536 and 2048 (RSA-3072 and RSA-4096).
+        const bool ifma_size = pbits == 1024 || (OpenSSL_version_num() >= 0x30100000L && (pbits == 1536 || pbits == 2048));
+        if ((c & ifma) == ifma && pbits == qbits && ifma_size) {
+            return "avx512-ifma (ossl_rsaz_mod_exp_avx512_x2)";
+        }
+        // The AVX2 code is used for 1024-bit factors, when mulx/adx are not available.
+        if (pbits == 1024 && (c & IA32CAP_AVX2) != 0 && !adx) {
+            return "avx2 (rsaz_1024_mod_exp_avx2)";
+        }
+    }
+    return adx ? "adx-bmi2 (bn_mulx4x_mont)" : "x86_64 (bn_mul_mont)";
+}
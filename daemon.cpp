@@ -0,0 +1,389 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Local signing daemon over a Unix domain socket, and its client connection.
+//
+// The server loads the key pairs and serves RSA operations, typically
+// sign and decrypt, as a keyless or KMS-like service would do. Requests
+// from all connections are queued to a pool of worker threads. Each worker
+// dequeues up to --batch requests at once, waiting at most --batch-wait
+// microseconds for a batch to fill. All responses of a batch which belong
+// to the same connection are sent in one single write.
+//
+// Each response carries the time the request spent in the server queue, the
+// time of the RSA operation itself and the size of the batch which contained
+// the request. The client subtracts the times from the end-to-end latency to
+// isolate the IPC overhead.
+//
+// A batch can contain at most one request per outstanding request of all
+// connections. To fill batches with few connections, each client connection
+// pipelines up to --batch requests.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Protocol. All fields are in native byte order: the socket is local.
+constexpr uint32_t REQUEST_MAGIC = 0x52534151;   // "RSAQ"
+constexpr uint32_t RESPONSE_MAGIC = 0x52534152;  // "RSAR"
+constexpr uint32_t MAX_PAYLOAD = 4096;
+
+namespace {
+    struct RequestHeader
+    {
+        uint32_t magic;
+        uint32_t op;      // RSAOpType
+        uint32_t length;  // payload size
+        uint32_t reserved;
+        uint64_t id;      // echoed in response
+        char     key[32]; // key name, RSAKeys::algo(), e.g. "RSA-2048-e3"
+    };
+
+    struct ResponseHeader
+    {
+        uint32_t magic;
+        uint32_t status;      // 1 = success, 0 = error
+        uint32_t length;      // payload size
+        uint32_t batch;       // number of requests in the batch
+        uint64_t id;          // from request
+        uint64_t queue_ns;    // time in server queue
+        uint64_t service_ns;  // time in RSA operation
+    };
+}
+
+
+//----------------------------------------------------------------------------
+// Read or write exactly a given size on a socket. Return false on error or
+// end of stream.
+//----------------------------------------------------------------------------
+
+static bool read_full(int fd, void* data, size_t size)
+{
+    uint8_t* p = reinterpret_cast<uint8_t*>(data);
+    while (size > 0) {
+        const ssize_t n = ::read(fd, p, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= size_t(n);
+    }
+    return true;
+}
+
+static bool write_full(int fd, const void* data, size_t size)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    while (size > 0) {
+        const ssize_t n = ::write(fd, p, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= size_t(n);
+    }
+    return true;
+}
+
+// Build a Unix socket address. Abort on error.
+static sockaddr_un socket_address(const std::string& path)
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "rsabench: socket path too long: " << path << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    std::memcpy(addr.sun_path, path.data(), path.size());
+    return addr;
+}
+
+
+//----------------------------------------------------------------------------
+// Server side.
+//----------------------------------------------------------------------------
+
+namespace {
+    // One client connection. The socket is closed when the last pending request is completed.
+    struct Connection
+    {
+        Connection(int s) : fd(s) {}
+        ~Connection() { ::close(fd); }
+        const int  fd;
+        std::mutex write_mutex {};
+    };
+    using ConnectionPtr = std::shared_ptr<Connection>;
+
+    // One pending request.
+    struct Request
+    {
+        ConnectionPtr conn {};
+        RequestHeader header {};
+        std::vector<uint8_t> payload {};
+        int64_t received = 0;  // wall time in nanoseconds
+    };
+
+    // Server state.
+    struct Server
+    {
+        std::vector<std::unique_ptr<RSAKeys>> keys {};
+        std::deque<Request> queue {};
+        std::mutex mutex {};
+        std::condition_variable cond {};
+        std::atomic<uint64_t> requests {0};
+        std::atomic<uint64_t> batches {0};
+    };
+}
+
+// Read requests from one connection into the server queue.
+static void connection_reader(Server& server, ConnectionPtr conn)
+{
+    for (;;) {
+        Request req;
+        req.conn = conn;
+        if (!read_full(conn->fd, &req.header, sizeof(req.header)) ||
+            req.header.magic != REQUEST_MAGIC ||
+            req.header.length > MAX_PAYLOAD)
+        {
+            break;
+        }
+        req.payload.resize(req.header.length);
+        if (!read_full(conn->fd, req.payload.data(), req.payload.size())) {
+            break;
+        }
+        req.received = wall_time_ns();
+        {
+            std::lock_guard<std::mutex> lock(server.mutex);
+            server.queue.push_back(std::move(req));
+        }
+        server.cond.notify_one();
+    }
+    ::shutdown(conn->fd, SHUT_RD);
+}
+
+// Worker thread: process micro-batches of requests.
+static void server_worker(Server& server)
+{
+    // One operation context per key and per operation type. Several keys may have
+    // the same size with distinct public exponents, the keys are identified by name.
+    std::map<std::pair<std::string, int>, std::unique_ptr<RSAOperation>> ops;
+    for (const auto& keys : server.keys) {
+        for (size_t i = 0; i < RSA_OP_COUNT; i++) {
+            ops[std::make_pair(keys->algo(), int(i))].reset(new RSAOperation(*keys, RSAOpType(i)));
+        }
+    }
+
+    std::vector<Request> batch;
+    std::vector<uint8_t> output(MAX_PAYLOAD);
+    std::map<ConnectionPtr, std::vector<uint8_t>> responses;
+
+    for (;;) {
+        // Get a batch of requests.
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(server.mutex);
+            server.cond.wait(lock, [&server]() { return !server.queue.empty(); });
+            if (opt.batch > 1 && opt.batch_wait > 0 && server.queue.size() < opt.batch) {
+                server.cond.wait_for(lock, std::chrono::microseconds(opt.batch_wait), [&server]() { return server.queue.size() >= opt.batch; });
+            }
+            while (!server.queue.empty() && batch.size() < opt.batch) {
+                batch.push_back(std::move(server.queue.front()));
+                server.queue.pop_front();
+            }
+        }
+        if (batch.empty()) {
+            continue;
+        }
+
+        // Process all requests, accumulate responses per connection.
+        responses.clear();
+        for (auto& req : batch) {
+            const int64_t start = wall_time_ns();
+            const auto it = ops.find(std::make_pair(std::string(req.header.key, strnlen(req.header.key, sizeof(req.header.key))), int(req.header.op)));
+            size_t output_size = output.size();
+            const bool ok = it != ops.end() && it->second->process(req.payload.data(), req.payload.size(), output.data(), output_size);
+            const int64_t end = wall_time_ns();
+            ResponseHeader resp;
+            std::memset(&resp, 0, sizeof(resp));
+            resp.magic = RESPONSE_MAGIC;
+            resp.status = ok;
+            resp.length = uint32_t(output_size);
+            resp.batch = uint32_t(batch.size());
+            resp.id = req.header.id;
+            resp.queue_ns = uint64_t(start - req.received);
+            resp.service_ns = uint64_t(end - start);
+            auto& buffer(responses[req.conn]);
+            const uint8_t* hp = reinterpret_cast<const uint8_t*>(&resp);
+            buffer.insert(buffer.end(), hp, hp + sizeof(resp));
+            buffer.insert(buffer.end(), output.begin(), output.begin() + output_size);
+        }
+
+        // Send responses, one write per connection.
+        for (const auto& it : responses) {
+            std::lock_guard<std::mutex> lock(it.first->write_mutex);
+            write_full(it.first->fd, it.second.data(), it.second.size());
+        }
+        server.requests += batch.size();
+        server.batches++;
+    }
+}
+
+// Run the signing daemon.
+void run_server()
+{
+    Server server;
+    for (const auto& key_name : opt.keys) {
+        server.keys.emplace_back(new RSAKeys("rsa-" + key_name));
+    }
+
+    // Termination signals are synchronously received by the main thread.
+    // Broken connections shall not kill the server.
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sigs, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // Create the listening socket.
+    const sockaddr_un addr(socket_address(opt.server));
+    const int sock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        perror("socket");
+        std::exit(EXIT_FAILURE);
+    }
+    ::unlink(opt.server.c_str());
+    if (::bind(sock, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(sock, 128) < 0) {
+        perror(opt.server.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::cout << "server-socket: " << opt.server << std::endl;
+    std::cout << "server-workers: " << opt.workers << std::endl;
+    std::cout << "server-batch: " << opt.batch << std::endl;
+    std::cout << "server-batch-wait-usec: " << opt.batch_wait << std::endl;
+    for (const auto& keys : server.keys) {
+        std::cout << "server-key: " << keys->algo() << std::endl;
+    }
+
+    // Start the workers and the connection listener.
+    for (size_t i = 0; i < opt.workers; i++) {
+        std::thread(server_worker, std::ref(server)).detach();
+    }
+    std::thread([&server, sock]() {
+        for (;;) {
+            const int fd = ::accept(sock, nullptr, nullptr);
+            if (fd >= 0) {
+                std::thread(connection_reader, std::ref(server), std::make_shared<Connection>(fd)).detach();
+            }
+            else if (errno != EINTR && errno != ECONNABORTED) {
+                break;
+            }
+        }
+    }).detach();
+
+    // Wait for a termination signal.
+    int sig = 0;
+    sigwait(&sigs, &sig);
+    ::unlink(opt.server.c_str());
+    const uint64_t requests = server.requests;
+    const uint64_t batches = server.batches;
+    std::cout << "server-requests: " << requests << std::endl;
+    std::cout << "server-mean-batch: " << (batches == 0 ? 0.0 : double(requests) / double(batches)) << std::endl;
+    std::exit(EXIT_SUCCESS);
+}
+
+
+//----------------------------------------------------------------------------
+// Client connection: run requests in closed loop until the end time, with
+// up to --batch outstanding requests.
+//----------------------------------------------------------------------------
+
+void socket_connection(const RSAKeys& keys, const RSAOperation& op, int64_t end, ClientStats& stats)
+{
+    const sockaddr_un addr(socket_address(opt.client));
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+        perror(opt.client.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+
+    // Build the request once, only the id changes.
+    const std::vector<uint8_t> data(op.request_data());
+    RequestHeader req;
+    std::memset(&req, 0, sizeof(req));
+    req.magic = REQUEST_MAGIC;
+    req.op = uint32_t(op.type());
+    if (keys.algo().size() > sizeof(req.key)) {
+        fatal("key name too long: " + keys.algo());
+    }
+    std::memcpy(req.key, keys.algo().data(), keys.algo().size());
+    req.length = uint32_t(data.size());
+    std::vector<uint8_t> message(sizeof(req) + data.size());
+    std::memcpy(message.data() + sizeof(req), data.data(), data.size());
+
+    ResponseHeader resp;
+    std::vector<uint8_t> payload(MAX_PAYLOAD);
+
+    // Send time of outstanding requests, by id. Responses may come out of order.
+    std::map<uint64_t, int64_t> pending;
+    uint64_t next_id = 0;
+    const auto send = [&]() {
+        req.id = next_id++;
+        std::memcpy(message.data(), &req, sizeof(req));
+        pending[req.id] = wall_time_ns();
+        if (!write_full(fd, message.data(), message.size())) {
+            fatal("connection to server broken");
+        }
+    };
+
+    while (pending.size() < opt.batch) {
+        send();
+    }
+    while (!pending.empty()) {
+        if (!read_full(fd, &resp, sizeof(resp)) ||
+            resp.magic != RESPONSE_MAGIC ||
+            resp.length > payload.size() ||
+            !read_full(fd, payload.data(), resp.length))
+        {
+            fatal("connection to server broken");
+        }
+        const auto it = pending.find(resp.id);
+        if (it == pending.end() || resp.status != 1) {
+            fatal(std::string("server error on ") + op.name());
+        }
+        stats.latency.push_back(wall_time_ns() - it->second);
+        pending.erase(it);
+        stats.queue += resp.queue_ns;
+        stats.service += resp.service_ns;
+        stats.batch += resp.batch;
+        if (wall_time_ns() < end) {
+            send();
+        }
+    }
+    ::close(fd);
+}
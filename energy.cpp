@@ -0,0 +1,151 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Energy consumption, using the Linux powercap interface (Intel and AMD RAPL).
+//
+// The RAPL counters are cumulative energy counters in microjoules, one per
+// domain: one "package" domain per CPU socket, with "core" (and sometimes
+// "uncore" or "dram") subdomains. They wrap around at max_energy_range_uj.
+// The counters are system-wide: any other activity on the system is counted.
+//
+// On recent kernels, energy_uj is readable by root only. When no domain can
+// be read, a warning is displayed once and no energy is reported.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <fstream>
+#include <filesystem>
+#include <cstdio>
+
+namespace {
+    // One RAPL domain.
+    struct EnergyDomain
+    {
+        std::string kind {};        // "package" or "core"
+        std::string path {};        // energy_uj file
+        uint64_t    max_range = 0;  // wrap around value
+    };
+}
+
+
+//----------------------------------------------------------------------------
+// Read a numerical value from a sysfs file.
+//----------------------------------------------------------------------------
+
+static bool read_uint(const std::string& path, uint64_t& value)
+{
+    std::ifstream file(path);
+    return bool(file >> value);
+}
+
+
+//----------------------------------------------------------------------------
+// Get the list of readable domains, computed once.
+//----------------------------------------------------------------------------
+
+static const std::vector<EnergyDomain>& energy_domains()
+{
+    static const std::vector<EnergyDomain> domains([]() {
+        std::vector<EnergyDomain> list;
+        std::error_code err;
+        for (const auto& entry : std::filesystem::directory_iterator("/sys/class/powercap", err)) {
+            // Zones are intel-rapl:N (package) and intel-rapl:N:M (subdomain). Skip the mmio and psys zones.
+            const std::string dir(entry.path());
+            const std::string zone(entry.path().filename());
+            std::ifstream name_file(dir + "/name");
+            std::string name;
+            std::getline(name_file, name);
+            EnergyDomain dom;
+            dom.path = dir + "/energy_uj";
+            if (zone.compare(0, 11, "intel-rapl:") != 0) {
+                continue;
+            }
+            else if (name.compare(0, 8, "package-") == 0) {
+                dom.kind = "package";
+            }
+            else if (name == "core") {
+                dom.kind = "core";
+            }
+            else {
+                continue;
+            }
+            uint64_t value = 0;
+            if (read_uint(dom.path, value) && read_uint(dir + "/max_energy_range_uj", dom.max_range)) {
+                list.push_back(dom);
+            }
+        }
+        if (list.empty()) {
+            std::cerr << "rsabench: RAPL energy counters unavailable in /sys/class/powercap" << std::endl;
+        }
+        return list;
+    }());
+    return domains;
+}
+
+
+//----------------------------------------------------------------------------
+// Get a snapshot of all energy counters.
+//----------------------------------------------------------------------------
+
+EnergySample energy_sample()
+{
+    EnergySample sample;
+    sample.time = wall_time_ns();
+    for (const auto& dom : energy_domains()) {
+        uint64_t value = 0;
+        read_uint(dom.path, value);
+        sample.counters.push_back(value);
+    }
+    return sample;
+}
+
+
+//----------------------------------------------------------------------------
+// Print the energy consumption of a test loop.
+//----------------------------------------------------------------------------
+
+void print_energy(const char* name, uint64_t count, const EnergySample& start, const EnergySample& end)
+{
+    const std::vector<EnergyDomain>& domains(energy_domains());
+    if (domains.empty() || start.counters.size() != domains.size() || end.counters.size() != domains.size()) {
+        return;
+    }
+
+    // Total energy per kind of domain, in joules.
+    double package = 0.0;
+    double core = 0.0;
+    bool has_core = false;
+    for (size_t i = 0; i < domains.size(); i++) {
+        uint64_t uj = end.counters[i] - start.counters[i];
+        if (end.counters[i] < start.counters[i]) {
+            uj += domains[i].max_range + 1;
+        }
+        if (domains[i].kind == "package") {
+            package += double(uj) / double(USECPERSEC);
+        }
+        else {
+            core += double(uj) / double(USECPERSEC);
+            has_core = true;
+        }
+    }
+
+    const double ops = double(count == 0 ? 1 : count);
+    const double seconds = double(end.time - start.time) / double(NSECPERSEC);
+    if (package > 0.0) {
+        std::printf("%s-joules-per-op: %.6f\n", name, package / ops);
+        std::printf("%s-ops-per-joule: %.1f\n", name, ops / package);
+        if (seconds > 0.0) {
+            std::printf("%s-package-watts: %.2f\n", name, package / seconds);
+        }
+    }
+    if (has_core && core > 0.0) {
+        std::printf("%s-core-joules-per-op: %.6f\n", name, core / ops);
+        if (seconds > 0.0) {
+            std::printf("%s-core-watts: %.2f\n", name, core / seconds);
+        }
+    }
+    std::fflush(stdout);
+}
@@ -0,0 +1,283 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Libgcrypt crypto backend.
+//
+// Libgcrypt uses S-expressions for keys, data and results. The input
+// S-expressions are built once. The results are parsed after each
+// operation, as an application would do.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+
+#if defined(HAVE_GCRYPT)
+
+#include <cstring>
+#include <gcrypt.h>
+
+namespace {
+    class GcryptOperation : public BackendOperation
+    {
+    public:
+        GcryptOperation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash);
+        virtual ~GcryptOperation() override;
+        virtual void run() override;
+
+    private:
+        gcry_sexp_t _key = nullptr;   // public or private key
+        gcry_sexp_t _data = nullptr;  // input data, as expected by the operation
+        gcry_sexp_t _sig = nullptr;   // signature to verify
+        std::string _hash {};         // PSS hash name
+
+        // Build the S-expression of data to encrypt or sign.
+        gcry_sexp_t data_sexp(RSAOpType type) const;
+
+        // Run an operation on S-expressions, return the result. Abort on error.
+        gcry_sexp_t call(RSAOpType type, gcry_sexp_t data, gcry_sexp_t key) const;
+
+        // Store an element of a result in the output buffer.
+        void store_output(gcry_sexp_t result, const char* token);
+    };
+
+    class GcryptBackend : public Backend
+    {
+    public:
+        GcryptBackend()
+        {
+            gcry_check_version(nullptr);
+            gcry_control(GCRYCTL_DISABLE_SECMEM, 0);
+            gcry_control(GCRYCTL_INITIALIZATION_FINISHED, 0);
+        }
+        virtual std::string name() const override
+        {
+            return "gcrypt";
+        }
+        virtual std::string version() const override
+        {
+            return std::string("libgcrypt ") + gcry_check_version(nullptr);
+        }
+        virtual BackendOperation* new_operation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash) override
+        {
+            return new GcryptOperation(keys, type, pss_hash);
+        }
+    };
+}
+
+Backend* new_gcrypt_backend()
+{
+    return new GcryptBackend;
+}
+
+
+//----------------------------------------------------------------------------
+// Libgcrypt error, abort application.
+//----------------------------------------------------------------------------
+
+[[noreturn]] static void gcrypt_fatal(const std::string& message, gcry_error_t err)
+{
+    std::cerr << "gcrypt: " << message << ": " << gcry_strerror(err) << std::endl;
+    std::exit(EXIT_FAILURE);
+}
+
+// Build an MPI from a big-endian byte array.
+static gcry_mpi_t new_mpi(const std::vector<uint8_t>& bytes)
+{
+    gcry_mpi_t mpi = nullptr;
+    const gcry_error_t err = gcry_mpi_scan(&mpi, GCRYMPI_FMT_USG, bytes.data(), bytes.size(), nullptr);
+    if (err) {
+        gcrypt_fatal("gcry_mpi_scan", err);
+    }
+    return mpi;
+}
+
+
+//----------------------------------------------------------------------------
+// Prepare one operation.
+//----------------------------------------------------------------------------
+
+GcryptOperation::GcryptOperation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash) :
+    BackendOperation(type),
+    _hash(EVP_MD_get0_name(pss_hash))
+{
+    init_plain(keys.size(), pss_hash);
+
+    // Libgcrypt requires p < q and u = p^-1 mod q.
+    const RSAKeyComponents comp(key_components(keys));
+    gcry_mpi_t n = new_mpi(comp.n);
+    gcry_mpi_t e = new_mpi(comp.e);
+    gcry_mpi_t d = new_mpi(comp.d);
+    gcry_mpi_t p = new_mpi(comp.p);
+    gcry_mpi_t q = new_mpi(comp.q);
+    gcry_mpi_t u = gcry_mpi_new(0);
+    if (gcry_mpi_cmp(p, q) > 0) {
+        gcry_mpi_swap(p, q);
+    }
+    gcry_mpi_invm(u, p, q);
+
+    gcry_sexp_t pub = nullptr;
+    gcry_sexp_t priv = nullptr;
+    gcry_error_t err = gcry_sexp_build(&pub, nullptr, "(public-key (rsa (n %m) (e %m)))", n, e);
+    if (!err) {
+        err = gcry_sexp_build(&priv, nullptr, "(private-key (rsa (n %m) (e %m) (d %m) (p %m) (q %m) (u %m)))", n, e, d, p, q, u);
+    }
+    if (err) {
+        gcrypt_fatal("error building keys", err);
+    }
+    for (auto mpi : {n, e, d, p, q, u}) {
+        gcry_mpi_release(mpi);
+    }
+
+    // The data s-expression is built once. For a decryption or a verification, it
+    // contains the ciphertext or the signature of the plain data, computed here.
+    gcry_sexp_t data = nullptr;
+    gcry_sexp_t result = nullptr;
+    switch (type) {
+        case OAEP_ENCRYPT:
+            _input = _plain;
+            _data_size = _input.size();
+            _data = data_sexp(OAEP_ENCRYPT);
+            _key = pub;
+            pub = nullptr;
+            break;
+        case OAEP_DECRYPT:
+            data = data_sexp(OAEP_ENCRYPT);
+            result = call(OAEP_ENCRYPT, data, pub);
+            store_output(result, "a");
+            _input.assign(_output.begin(), _output.begin() + _output_len);
+            _data_size = _input.size();
+            err = gcry_sexp_build(&_data, nullptr, "(enc-val (flags oaep) (hash-algo sha1) (rsa (a %b)))", int(_input.size()), _input.data());
+            if (err) {
+                gcrypt_fatal("error building ciphertext", err);
+            }
+            _key = priv;
+            priv = nullptr;
+            break;
+        case PSS_SIGN:
+            _input = _plain;
+            _data_size = keys.size() / 2;
+            _data = data_sexp(PSS_SIGN);
+            _key = priv;
+            priv = nullptr;
+            break;
+        case PSS_VERIFY:
+            _data = data_sexp(PSS_SIGN);
+            _sig = call(PSS_SIGN, _data, priv);
+            store_output(_sig, "s");
+            _input.assign(_output.begin(), _output.begin() + _output_len);
+            _data_size = _input.size();
+            _key = pub;
+            pub = nullptr;
+            break;
+    }
+    gcry_sexp_release(data);
+    gcry_sexp_release(result);
+    gcry_sexp_release(pub);
+    gcry_sexp_release(priv);
+    _output_len = 0;
+}
+
+GcryptOperation::~GcryptOperation()
+{
+    gcry_sexp_release(_sig);
+    gcry_sexp_release(_data);
+    gcry_sexp_release(_key);
+}
+
+
+//----------------------------------------------------------------------------
+// Build the S-expression of data to encrypt or sign.
+//----------------------------------------------------------------------------
+
+gcry_sexp_t GcryptOperation::data_sexp(RSAOpType type) const
+{
+    gcry_sexp_t data = nullptr;
+    gcry_error_t err = 0;
+    if (type == OAEP_ENCRYPT) {
+        err = gcry_sexp_build(&data, nullptr, "(data (flags oaep) (hash-algo sha1) (value %b))", int(_plain.size()), _plain.data());
+    }
+    else {
+        err = gcry_sexp_build(&data, nullptr, "(data (flags pss) (hash %s %b) (salt-length %d))",
+                              _hash.c_str(), int(_plain.size()), _plain.data(), int(_plain.size()));
+    }
+    if (err) {
+        gcrypt_fatal("error building data", err);
+    }
+    return data;
+}
+
+
+//----------------------------------------------------------------------------
+// Run an operation on S-expressions, return the result. Abort on error.
+//----------------------------------------------------------------------------
+
+gcry_sexp_t GcryptOperation::call(RSAOpType type, gcry_sexp_t data, gcry_sexp_t key) const
+{
+    gcry_sexp_t result = nullptr;
+    gcry_error_t err = 0;
+    switch (type) {
+        case OAEP_ENCRYPT:
+            err = gcry_pk_encrypt(&result, data, key);
+            break;
+        case OAEP_DECRYPT:
+            err = gcry_pk_decrypt(&result, data, key);
+            break;
+        case PSS_SIGN:
+            err = gcry_pk_sign(&result, data, key);
+            break;
+        case PSS_VERIFY:
+            err = gcry_pk_verify(_sig, data, key);
+            break;
+    }
+    if (err) {
+        gcrypt_fatal(std::string("RSA ") + op_name(type) + " error", err);
+    }
+    return result;
+}
+
+
+//----------------------------------------------------------------------------
+// Store an element of a result in the output buffer.
+//----------------------------------------------------------------------------
+
+void GcryptOperation::store_output(gcry_sexp_t result, const char* token)
+{
+    gcry_sexp_t elem = gcry_sexp_find_token(result, token, 0);
+    size_t len = 0;
+    const char* data = elem == nullptr ? nullptr : gcry_sexp_nth_data(elem, 1, &len);
+    if (data == nullptr || len > _output.size()) {
+        std::cerr << "gcrypt: cannot find '" << token << "' in result" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    std::memcpy(_output.data(), data, len);
+    _output_len = len;
+    gcry_sexp_release(elem);
+}
+
+
+//----------------------------------------------------------------------------
+// Run the operation once.
+//----------------------------------------------------------------------------
+
+void GcryptOperation::run()
+{
+    gcry_sexp_t result = call(_type, _data, _key);
+    switch (_type) {
+        case OAEP_ENCRYPT:
+            store_output(result, "a");
+            break;
+        case OAEP_DECRYPT:
+            store_output(result, "value");
+            break;
+        case PSS_SIGN:
+            store_output(result, "s");
+            break;
+        case PSS_VERIFY:
+            break;
+    }
+    gcry_sexp_release(result);
+}
+
+#endif // HAVE_GCRYPT
@@ -0,0 +1,127 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// GMP crypto backend: raw modular exponentiations with GMP, paddings with
+// OpenSSL. The private operation uses the CRT with mpz_powm_sec(), the
+// side-channel silent exponentiation, as a cryptographic library would do.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+
+#if defined(HAVE_GMP)
+
+#include <gmp.h>
+
+namespace {
+    class GMPOperation : public RawOperation
+    {
+    public:
+        GMPOperation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash);
+        virtual ~GMPOperation() override;
+
+    protected:
+        virtual void raw_private(const uint8_t* in, uint8_t* out) override;
+        virtual void raw_public(const uint8_t* in, uint8_t* out) override;
+
+    private:
+        size_t _size;
+        mpz_t _n, _e, _p, _q, _dp, _dq, _qinv;  // key components
+        mpz_t _x, _m1, _m2, _h;                 // work area
+    };
+
+    class GMPBackend : public Backend
+    {
+    public:
+        virtual std::string name() const override
+        {
+            return "gmp";
+        }
+        virtual std::string version() const override
+        {
+            return std::string("GMP ") + gmp_version;
+        }
+        virtual BackendOperation* new_operation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash) override
+        {
+            return new GMPOperation(keys, type, pss_hash);
+        }
+    };
+}
+
+Backend* new_gmp_backend()
+{
+    return new GMPBackend;
+}
+
+
+//----------------------------------------------------------------------------
+// Big-endian byte arrays to and from GMP integers.
+//----------------------------------------------------------------------------
+
+static void import_bytes(mpz_t x, const std::vector<uint8_t>& bytes)
+{
+    mpz_import(x, bytes.size(), 1, 1, 1, 0, bytes.data());
+}
+
+static void export_bytes(const mpz_t x, uint8_t* out, size_t size)
+{
+    // Left-pad with zeroes to the key size.
+    const size_t len = (mpz_sizeinbase(x, 2) + 7) / 8;
+    std::fill(out, out + size, 0);
+    if (len <= size) {
+        mpz_export(out + size - len, nullptr, 1, 1, 1, 0, x);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// GMP operation.
+//----------------------------------------------------------------------------
+
+GMPOperation::GMPOperation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash) :
+    RawOperation(keys, type, pss_hash),
+    _size(keys.size())
+{
+    mpz_inits(_n, _e, _p, _q, _dp, _dq, _qinv, _x, _m1, _m2, _h, nullptr);
+    const RSAKeyComponents comp(key_components(keys));
+    import_bytes(_n, comp.n);
+    import_bytes(_e, comp.e);
+    import_bytes(_p, comp.p);
+    import_bytes(_q, comp.q);
+    import_bytes(_dp, comp.dp);
+    import_bytes(_dq, comp.dq);
+    import_bytes(_qinv, comp.qinv);
+    init();
+}
+
+GMPOperation::~GMPOperation()
+{
+    mpz_clears(_n, _e, _p, _q, _dp, _dq, _qinv, _x, _m1, _m2, _h, nullptr);
+}
+
+void GMPOperation::raw_public(const uint8_t* in, uint8_t* out)
+{
+    mpz_import(_x, _size, 1, 1, 1, 0, in);
+    mpz_powm(_x, _x, _e, _n);
+    export_bytes(_x, out, _size);
+}
+
+void GMPOperation::raw_private(const uint8_t* in, uint8_t* out)
+{
+    // CRT: m1 = c^dp mod p, m2 = c^dq mod q, h = qinv.(m1 - m2) mod p, m = m2 + h.q
+    mpz_import(_x, _size, 1, 1, 1, 0, in);
+    mpz_mod(_m1, _x, _p);
+    mpz_powm_sec(_m1, _m1, _dp, _p);
+    mpz_mod(_m2, _x, _q);
+    mpz_powm_sec(_m2, _m2, _dq, _q);
+    mpz_sub(_h, _m1, _m2);
+    mpz_mul(_h, _h, _qinv);
+    mpz_mod(_h, _h, _p);
+    mpz_mul(_x, _h, _q);
+    mpz_add(_x, _x, _m2);
+    export_bytes(_x, out, _size);
+}
+
+#endif // HAVE_GMP
@@ -0,0 +1,165 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Description of the host, at the beginning of the results, so that the
+// results files are self-describing. Unavailable values are omitted.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <fstream>
+#include <set>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#if defined(__APPLE__)
+    #include <sys/sysctl.h>
+#endif
+
+
+//----------------------------------------------------------------------------
+// Read the first line of a text file, empty if not found.
+//----------------------------------------------------------------------------
+
+static std::string first_line(const std::string& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+
+//----------------------------------------------------------------------------
+// Get a sysctl string or integer value (macOS only), empty if not found.
+//----------------------------------------------------------------------------
+
+#if defined(__APPLE__)
+static std::string sysctl_string(const char* name)
+{
+    char value[256];
+    size_t size = sizeof(value);
+    return sysctlbyname(name, value, &size, nullptr, 0) == 0 && size > 0 ? std::string(value, size - 1) : "";
+}
+
+static int64_t sysctl_int(const char* name)
+{
+    int64_t value = 0;
+    size_t size = sizeof(value);
+    return sysctlbyname(name, &value, &size, nullptr, 0) == 0 ? value : 0;
+}
+#endif
+
+
+//----------------------------------------------------------------------------
+// Print the description of the host.
+//----------------------------------------------------------------------------
+
+void print_host_info()
+{
+    char name[256];
+    if (gethostname(name, sizeof(name)) == 0) {
+        name[sizeof(name) - 1] = '\0';
+        std::cout << "host-name: " << name << std::endl;
+    }
+    utsname un;
+    if (uname(&un) == 0) {
+        std::cout << "host-os: " << un.sysname << std::endl;
+        std::cout << "host-kernel: " << un.release << std::endl;
+        std::cout << "host-arch: " << un.machine << std::endl;
+    }
+    std::cout << "host-cpus: " << cpu_count() << std::endl;
+
+#if defined(__APPLE__)
+    std::cout << "host-cpu: " << sysctl_string("machdep.cpu.brand_string") << std::endl;
+    std::cout << "host-cores: " << sysctl_int("hw.physicalcpu") << std::endl;
+    std::cout << "host-smt: " << (sysctl_int("hw.logicalcpu") > sysctl_int("hw.physicalcpu") ? "on" : "off") << std::endl;
+    for (const auto& cache : {std::make_pair("l1d", "hw.perflevel0.l1dcachesize"),
+                              std::make_pair("l1i", "hw.perflevel0.l1icachesize"),
+                              std::make_pair("l2", "hw.perflevel0.l2cachesize")}) {
+        const int64_t size = sysctl_int(cache.second);
+        if (size > 0) {
+            std::cout << "host-cache-" << cache.first << "-kb: " << (size / 1024) << std::endl;
+        }
+    }
+    const int64_t freq = sysctl_int("hw.cpufrequency_max");
+    if (freq > 0) {
+        std::cout << "host-max-mhz: " << (freq / 1000000) << std::endl;
+    }
+    std::cout << "host-virtualized: " << (sysctl_int("kern.hv_vmm_present") != 0 ? "yes" : "no") << std::endl;
+#else
+    // CPU model from /proc/cpuinfo. On Arm, there is no model name, use the implementer and part numbers.
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line, model, implementer, part;
+    std::set<std::string> cores;
+    std::string physical;
+    bool hypervisor = false;
+    while (std::getline(cpuinfo, line)) {
+        const size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string key(line.substr(0, colon));
+        key.erase(key.find_last_not_of(" \t") + 1);
+        const std::string value(line.substr(std::min(line.size(), colon + 2)));
+        if (key == "model name" && model.empty()) {
+            model = value;
+        }
+        else if (key == "CPU implementer" && implementer.empty()) {
+            implementer = value;
+        }
+        else if (key == "CPU part" && part.empty()) {
+            part = value;
+        }
+        else if (key == "physical id") {
+            physical = value;
+        }
+        else if (key == "core id") {
+            cores.insert(physical + ":" + value);
+        }
+        else if (key == "flags") {
+            hypervisor = hypervisor || (" " + value + " ").find(" hypervisor ") != std::string::npos;
+        }
+    }
+    if (model.empty() && !implementer.empty()) {
+        model = "implementer " + implementer + " part " + part;
+    }
+    if (!model.empty()) {
+        std::cout << "host-cpu: " << model << std::endl;
+    }
+    if (!cores.empty()) {
+        std::cout << "host-cores: " << cores.size() << std::endl;
+    }
+
+    const std::string sys("/sys/devices/system/cpu/");
+    const std::string smt(first_line(sys + "smt/active"));
+    if (!smt.empty()) {
+        std::cout << "host-smt: " << (smt == "1" ? "on" : "off") << std::endl;
+    }
+    for (int index = 0; ; index++) {
+        const std::string dir(sys + "cpu0/cache/index" + std::to_string(index) + "/");
+        const std::string level(first_line(dir + "level"));
+        const std::string type(first_line(dir + "type"));
+        const std::string size(first_line(dir + "size"));
+        if (level.empty()) {
+            break;
+        }
+        // Size is formatted as "48K" or "2048K".
+        const std::string suffix(type == "Data" ? "d" : (type == "Instruction" ? "i" : ""));
+        std::cout << "host-cache-l" << level << suffix << "-kb: " << std::atol(size.c_str()) << std::endl;
+    }
+    const std::string max_khz(first_line(sys + "cpu0/cpufreq/cpuinfo_max_freq"));
+    if (!max_khz.empty()) {
+        std::cout << "host-max-mhz: " << (std::atol(max_khz.c_str()) / 1000) << std::endl;
+    }
+    const std::string governor(first_line(sys + "cpu0/cpufreq/scaling_governor"));
+    if (!governor.empty()) {
+        std::cout << "host-governor: " << governor << std::endl;
+    }
+    // The "hypervisor" CPU flag only exists on x86.
+    hypervisor = hypervisor || !first_line("/sys/hypervisor/type").empty();
+    std::cout << "host-virtualized: " << (hypervisor ? "yes" : "no") << std::endl;
+#endif
+}
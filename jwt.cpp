@@ -0,0 +1,217 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// JSON Web Tokens (JWT, RFC 7519) with RSA signatures (RFC 7518).
+//
+// - sign: build the header and the claims, base64url-encode them, sign.
+// - verify: split the token, decode and parse the header and the claims,
+//   check the algorithm and the expiration time, verify the signature.
+//
+// The JSON parsing is limited to what is needed for the tokens which are
+// built here. It is not a general-purpose JSON parser.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <ctime>
+#include <atomic>
+#include <openssl/rsa.h>
+
+namespace {
+    // Description of a JWT signature algorithm.
+    struct JWTAlgo
+    {
+        const char* name;      // "alg" in the header
+        const char* id;        // name in the output
+        const EVP_MD* (*md)(); // hash function
+        bool pss;              // RSA-PSS or PKCS#1 v1.5
+    };
+
+    const JWTAlgo JWT_ALGOS[] = {
+        {"RS256", "rs256", EVP_sha256, false},
+        {"PS256", "ps256", EVP_sha256, true},
+        {"PS512", "ps512", EVP_sha512, true},
+    };
+
+    // Unique token id, shared by all threads.
+    std::atomic<uint64_t> jwt_id(0);
+}
+
+
+//----------------------------------------------------------------------------
+// Base64url encoding and decoding, without padding.
+//----------------------------------------------------------------------------
+
+static std::string base64url_encode(const void* data, size_t size)
+{
+    std::string str(4 * ((size + 2) / 3) + 1, '\0');
+    const int len = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(&str[0]), reinterpret_cast<const unsigned char*>(data), int(size));
+    str.resize(std::max(len, 0));
+    while (!str.empty() && str.back() == '=') {
+        str.pop_back();
+    }
+    for (auto& c : str) {
+        c = c == '+' ? '-' : (c == '/' ? '_' : c);
+    }
+    return str;
+}
+
+static bool base64url_decode(const std::string& str, std::string& data)
+{
+    std::string b64(str);
+    for (auto& c : b64) {
+        c = c == '-' ? '+' : (c == '_' ? '/' : c);
+    }
+    const size_t pad = (4 - b64.size() % 4) % 4;
+    if (pad == 3) {
+        return false;
+    }
+    b64.append(pad, '=');
+    data.resize(3 * b64.size() / 4);
+    const int len = EVP_DecodeBlock(reinterpret_cast<unsigned char*>(&data[0]), reinterpret_cast<const unsigned char*>(b64.data()), int(b64.size()));
+    if (len < 0) {
+        return false;
+    }
+    // EVP_DecodeBlock() does not remove the padding bytes.
+    data.resize(size_t(len) - pad);
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Get the value of a member in a flat JSON object, as a string.
+//----------------------------------------------------------------------------
+
+static bool json_value(const std::string& json, const std::string& name, std::string& value)
+{
+    const std::string key("\"" + name + "\"");
+    size_t pos = json.find(key);
+    if (pos == std::string::npos || (pos = json.find_first_not_of(" \t\r\n", pos + key.size())) == std::string::npos || json[pos] != ':') {
+        return false;
+    }
+    pos = json.find_first_not_of(" \t\r\n", pos + 1);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    if (json[pos] == '"') {
+        const size_t end = json.find('"', pos + 1);
+        if (end == std::string::npos) {
+            return false;
+        }
+        value = json.substr(pos + 1, end - pos - 1);
+    }
+    else {
+        const size_t end = json.find_first_of(",} \t\r\n", pos);
+        value = json.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+    }
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Initialize a digest sign or verify context for a JWT algorithm.
+//----------------------------------------------------------------------------
+
+static EVP_MD_CTX* new_md_ctx(const JWTAlgo& algo, EVP_PKEY* key, bool sign)
+{
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    EVP_PKEY_CTX* pctx = nullptr;
+    if (ctx == nullptr ||
+        (sign ? EVP_DigestSignInit(ctx, &pctx, algo.md(), nullptr, key) : EVP_DigestVerifyInit(ctx, &pctx, algo.md(), nullptr, key)) <= 0 ||
+        // RFC 7518: the PSS salt has the size of the hash.
+        (algo.pss && (EVP_PKEY_CTX_set_rsa_padding(pctx, RSA_PKCS1_PSS_PADDING) <= 0 || EVP_PKEY_CTX_set_rsa_pss_saltlen(pctx, RSA_PSS_SALTLEN_DIGEST) <= 0)))
+    {
+        fatal(std::string("error initializing ") + algo.name + " context");
+    }
+    return ctx;
+}
+
+
+//----------------------------------------------------------------------------
+// Build and sign a token.
+//----------------------------------------------------------------------------
+
+static std::string jwt_sign(const JWTAlgo& algo, EVP_PKEY* key)
+{
+    const std::string header("{\"alg\":\"" + std::string(algo.name) + "\",\"typ\":\"JWT\"}");
+    const int64_t now = int64_t(std::time(nullptr));
+    const std::string claims("{\"iss\":\"https://auth.rsabench.local\",\"sub\":\"user-1234567890\",\"aud\":\"api.rsabench.local\","
+                             "\"iat\":" + std::to_string(now) + ",\"exp\":" + std::to_string(now + 3600) +
+                             ",\"jti\":\"" + std::to_string(++jwt_id) + "\",\"scope\":\"read write\"}");
+    const std::string input(base64url_encode(header.data(), header.size()) + "." + base64url_encode(claims.data(), claims.size()));
+
+    EVP_MD_CTX* ctx = new_md_ctx(algo, key, true);
+    std::vector<uint8_t> sig(EVP_PKEY_get_size(key));
+    size_t sig_len = sig.size();
+    if (EVP_DigestSign(ctx, sig.data(), &sig_len, reinterpret_cast<const unsigned char*>(input.data()), input.size()) <= 0) {
+        fatal(std::string(algo.name) + " signature error");
+    }
+    EVP_MD_CTX_free(ctx);
+    return input + "." + base64url_encode(sig.data(), sig_len);
+}
+
+
+//----------------------------------------------------------------------------
+// Parse and verify a token. Abort on error, all tokens are valid here.
+//----------------------------------------------------------------------------
+
+static void jwt_verify(const JWTAlgo& algo, EVP_PKEY* key, const std::string& token)
+{
+    const size_t dot1 = token.find('.');
+    const size_t dot2 = dot1 == std::string::npos ? dot1 : token.find('.', dot1 + 1);
+    std::string header, claims, sig, alg, exp;
+    if (dot2 == std::string::npos ||
+        !base64url_decode(token.substr(0, dot1), header) ||
+        !base64url_decode(token.substr(dot1 + 1, dot2 - dot1 - 1), claims) ||
+        !base64url_decode(token.substr(dot2 + 1), sig) ||
+        !json_value(header, "alg", alg) ||
+        !json_value(claims, "exp", exp))
+    {
+        fatal("invalid JWT");
+    }
+    if (alg != algo.name || std::strtoll(exp.c_str(), nullptr, 10) < int64_t(std::time(nullptr))) {
+        fatal("JWT rejected: algorithm " + alg + ", expiration " + exp);
+    }
+
+    EVP_MD_CTX* ctx = new_md_ctx(algo, key, false);
+    if (EVP_DigestVerify(ctx, reinterpret_cast<const unsigned char*>(sig.data()), sig.size(), reinterpret_cast<const unsigned char*>(token.data()), dot2) != 1) {
+        fatal(std::string(algo.name) + " signature verification error");
+    }
+    EVP_MD_CTX_free(ctx);
+}
+
+
+//----------------------------------------------------------------------------
+// Run the JWT tests, single-threaded and multi-threaded.
+//----------------------------------------------------------------------------
+
+void jwt_tests()
+{
+    // Multi-threaded: --threads or all CPU's.
+    const size_t mt = opt.threads > 1 ? opt.threads : cpu_count();
+    if (mt > 1) {
+        std::cout << "jwt-threads: " << mt << std::endl;
+    }
+
+    for (const auto& key : opt.keys) {
+        const RSAKeys keys("rsa-" + key);
+        std::cout << "algo: " << keys.algo() << std::endl;
+        std::cout << "key-size: " << keys.bits() << std::endl;
+
+        for (const auto& algo : JWT_ALGOS) {
+            const std::string token(jwt_sign(algo, keys.priv()));
+            std::cout << "jwt-" << algo.id << "-token-size: " << token.size() << std::endl;
+            const auto sign = [&]() { return [&]() { jwt_sign(algo, keys.priv()); }; };
+            const auto verify = [&]() { return [&]() { jwt_verify(algo, keys.pub(), token); }; };
+            const std::string prefix(std::string("jwt-") + algo.id);
+            parallel_loop((prefix + "-sign").c_str(), 0, 1, sign);
+            parallel_loop((prefix + "-verify").c_str(), 0, 1, verify);
+            if (mt > 1) {
+                parallel_loop((prefix + "-sign-mt").c_str(), 0, mt, sign);
+                parallel_loop((prefix + "-verify-mt").c_str(), 0, mt, verify);
+            }
+        }
+    }
+}
@@ -0,0 +1,174 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Mbed TLS crypto backend. Written for the 2.28 and 3.x API's but not yet
+// compiled against any version of Mbed TLS: consider it as untested.
+//
+// In Mbed TLS, the OAEP or PSS hash is an attribute of the RSA context.
+// Each operation uses its own context, with SHA-1 for OAEP (same as the
+// OpenSSL default) and the PSS hash for signatures.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+
+#if defined(HAVE_MBEDTLS)
+
+#include <openssl/rand.h>
+#include <mbedtls/version.h>
+#include <mbedtls/rsa.h>
+#include <mbedtls/md.h>
+
+namespace {
+    class MbedOperation : public BackendOperation
+    {
+    public:
+        MbedOperation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash);
+        virtual ~MbedOperation() override;
+        virtual void run() override;
+
+    private:
+        mbedtls_rsa_context _rsa;
+        mbedtls_md_type_t   _md;
+    };
+
+    class MbedBackend : public Backend
+    {
+    public:
+        virtual std::string name() const override
+        {
+            return "mbedtls";
+        }
+        virtual std::string version() const override
+        {
+            return "Mbed TLS " MBEDTLS_VERSION_STRING;
+        }
+        virtual BackendOperation* new_operation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash) override
+        {
+            return new MbedOperation(keys, type, pss_hash);
+        }
+    };
+}
+
+Backend* new_mbedtls_backend()
+{
+    return new MbedBackend;
+}
+
+
+//----------------------------------------------------------------------------
+// Random generator for Mbed TLS, using OpenSSL.
+//----------------------------------------------------------------------------
+
+static int random_bytes(void* ctx, unsigned char* dst, size_t length)
+{
+    return RAND_bytes(dst, int(length)) > 0 ? 0 : -1;
+}
+
+[[noreturn]] static void mbed_fatal(const std::string& message, int err)
+{
+    std::cerr << "mbedtls: " << message << ", error -0x" << std::hex << -err << std::dec << std::endl;
+    std::exit(EXIT_FAILURE);
+}
+
+// Mbed TLS hash identifier from an OpenSSL one.
+static mbedtls_md_type_t mbed_md(const EVP_MD* md)
+{
+    switch (EVP_MD_get_type(md)) {
+        case NID_sha1: return MBEDTLS_MD_SHA1;
+        case NID_sha224: return MBEDTLS_MD_SHA224;
+        case NID_sha256: return MBEDTLS_MD_SHA256;
+        case NID_sha384: return MBEDTLS_MD_SHA384;
+        case NID_sha512: return MBEDTLS_MD_SHA512;
+        default: fatal(std::string("Mbed TLS does not support PSS with ") + EVP_MD_get0_name(md));
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Prepare one operation.
+//----------------------------------------------------------------------------
+
+MbedOperation::MbedOperation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash) :
+    BackendOperation(type),
+    _rsa(),
+    _md(type == OAEP_ENCRYPT || type == OAEP_DECRYPT ? MBEDTLS_MD_SHA1 : mbed_md(pss_hash))
+{
+    init_plain(keys.size(), pss_hash);
+
+#if MBEDTLS_VERSION_MAJOR >= 3
+    mbedtls_rsa_init(&_rsa);
+#else
+    mbedtls_rsa_init(&_rsa, MBEDTLS_RSA_PKCS_V21, 0);
+#endif
+    mbedtls_rsa_set_padding(&_rsa, MBEDTLS_RSA_PKCS_V21, _md);
+
+    // Import n, p, q, d, e, let Mbed TLS compute the CRT parameters.
+    const RSAKeyComponents comp(key_components(keys));
+    int err = mbedtls_rsa_import_raw(&_rsa, comp.n.data(), comp.n.size(), comp.p.data(), comp.p.size(),
+                                     comp.q.data(), comp.q.size(), comp.d.data(), comp.d.size(), comp.e.data(), comp.e.size());
+    if (err == 0) {
+        err = mbedtls_rsa_complete(&_rsa);
+    }
+    if (err != 0) {
+        mbed_fatal("error importing RSA key", err);
+    }
+
+    init_input(keys.size());
+}
+
+MbedOperation::~MbedOperation()
+{
+    mbedtls_rsa_free(&_rsa);
+}
+
+
+//----------------------------------------------------------------------------
+// Run the operation once.
+//----------------------------------------------------------------------------
+
+void MbedOperation::run()
+{
+    const size_t key_size = mbedtls_rsa_get_len(&_rsa);
+    int err = 0;
+
+    switch (_type) {
+        case OAEP_ENCRYPT:
+#if MBEDTLS_VERSION_MAJOR >= 3
+            err = mbedtls_rsa_rsaes_oaep_encrypt(&_rsa, random_bytes, nullptr, nullptr, 0, _input.size(), _input.data(), _output.data());
+#else
+            err = mbedtls_rsa_rsaes_oaep_encrypt(&_rsa, random_bytes, nullptr, MBEDTLS_RSA_PUBLIC, nullptr, 0, _input.size(), _input.data(), _output.data());
+#endif
+            _output_len = key_size;
+            break;
+        case OAEP_DECRYPT:
+#if MBEDTLS_VERSION_MAJOR >= 3
+            err = mbedtls_rsa_rsaes_oaep_decrypt(&_rsa, random_bytes, nullptr, nullptr, 0, &_output_len, _input.data(), _output.data(), _output.size());
+#else
+            err = mbedtls_rsa_rsaes_oaep_decrypt(&_rsa, random_bytes, nullptr, MBEDTLS_RSA_PRIVATE, nullptr, 0, &_output_len, _input.data(), _output.data(), _output.size());
+#endif
+            break;
+        case PSS_SIGN:
+#if MBEDTLS_VERSION_MAJOR >= 3
+            err = mbedtls_rsa_rsassa_pss_sign(&_rsa, random_bytes, nullptr, _md, unsigned(_input.size()), _input.data(), _output.data());
+#else
+            err = mbedtls_rsa_rsassa_pss_sign(&_rsa, random_bytes, nullptr, MBEDTLS_RSA_PRIVATE, _md, unsigned(_input.size()), _input.data(), _output.data());
+#endif
+            _output_len = key_size;
+            break;
+        case PSS_VERIFY:
+#if MBEDTLS_VERSION_MAJOR >= 3
+            err = mbedtls_rsa_rsassa_pss_verify(&_rsa, _md, unsigned(_plain.size()), _plain.data(), _input.data());
+#else
+            err = mbedtls_rsa_rsassa_pss_verify(&_rsa, nullptr, nullptr, MBEDTLS_RSA_PUBLIC, _md, unsigned(_plain.size()), _plain.data(), _input.data());
+#endif
+            break;
+    }
+    if (err != 0) {
+        mbed_fatal(std::string("RSA ") + op_name(_type) + " error", err);
+    }
+}
+
+#endif // HAVE_MBEDTLS
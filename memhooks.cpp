@@ -0,0 +1,188 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Memory allocation accounting in OpenSSL.
+//
+// The OpenSSL allocation functions are replaced using CRYPTO_set_mem_functions().
+// Each block is prefixed with a small header which records its size, so that
+// the live memory size can be maintained when blocks are freed or reallocated.
+//
+// The underlying allocator is either the system one or the pool allocator.
+// Without accounting, the pool allocator is directly installed in OpenSSL.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <atomic>
+#include <cstdio>
+#include <openssl/crypto.h>
+
+// Size of the block header. Keep the alignment of malloc().
+constexpr size_t MEM_HEADER_SIZE = 16;
+
+namespace {
+    // Underlying allocator.
+    void* (*base_malloc)(size_t) = std::malloc;
+    void* (*base_realloc)(void*, size_t) = std::realloc;
+    void  (*base_free)(void*) = std::free;
+
+    std::atomic<uint64_t> mallocs {0};
+    std::atomic<uint64_t> reallocs {0};
+    std::atomic<uint64_t> frees {0};
+    std::atomic<uint64_t> bytes {0};
+    std::atomic<int64_t>  live {0};
+    std::atomic<int64_t>  peak {0};
+}
+
+
+//----------------------------------------------------------------------------
+// Update the live memory size and its peak value.
+//----------------------------------------------------------------------------
+
+static inline void add_live(int64_t size)
+{
+    const int64_t value = live.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t current = peak.load(std::memory_order_relaxed);
+    while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Allocation hooks.
+//----------------------------------------------------------------------------
+
+static void* hook_malloc(size_t num, const char* file, int line)
+{
+    uint8_t* base = reinterpret_cast<uint8_t*>(base_malloc(num + MEM_HEADER_SIZE));
+    if (base == nullptr) {
+        return nullptr;
+    }
+    *reinterpret_cast<size_t*>(base) = num;
+    mallocs.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(num, std::memory_order_relaxed);
+    add_live(int64_t(num));
+    return base + MEM_HEADER_SIZE;
+}
+
+static void hook_free(void* ptr, const char* file, int line)
+{
+    if (ptr != nullptr) {
+        uint8_t* base = reinterpret_cast<uint8_t*>(ptr) - MEM_HEADER_SIZE;
+        frees.fetch_add(1, std::memory_order_relaxed);
+        add_live(-int64_t(*reinterpret_cast<size_t*>(base)));
+        base_free(base);
+    }
+}
+
+static void* hook_realloc(void* ptr, size_t num, const char* file, int line)
+{
+    if (ptr == nullptr) {
+        return hook_malloc(num, file, line);
+    }
+    if (num == 0) {
+        hook_free(ptr, file, line);
+        return nullptr;
+    }
+    uint8_t* base = reinterpret_cast<uint8_t*>(ptr) - MEM_HEADER_SIZE;
+    const size_t old_size = *reinterpret_cast<size_t*>(base);
+    base = reinterpret_cast<uint8_t*>(base_realloc(base, num + MEM_HEADER_SIZE));
+    if (base == nullptr) {
+        return nullptr;
+    }
+    *reinterpret_cast<size_t*>(base) = num;
+    reallocs.fetch_add(1, std::memory_order_relaxed);
+    if (num > old_size) {
+        bytes.fetch_add(num - old_size, std::memory_order_relaxed);
+    }
+    add_live(int64_t(num) - int64_t(old_size));
+    return base + MEM_HEADER_SIZE;
+}
+
+
+//----------------------------------------------------------------------------
+// Pool allocator, directly installed in OpenSSL, without accounting.
+//----------------------------------------------------------------------------
+
+static void* direct_pool_malloc(size_t num, const char* file, int line)
+{
+    return pool_malloc(num);
+}
+
+static void* direct_pool_realloc(void* ptr, size_t num, const char* file, int line)
+{
+    if (num == 0) {
+        pool_free(ptr);
+        return nullptr;
+    }
+    return pool_realloc(ptr, num);
+}
+
+static void direct_pool_free(void* ptr, const char* file, int line)
+{
+    pool_free(ptr);
+}
+
+
+//----------------------------------------------------------------------------
+// Install the allocation hooks. Must be called before any OpenSSL call.
+//----------------------------------------------------------------------------
+
+void install_mem_hooks()
+{
+    int status = 0;
+    if (opt.pool_alloc && !opt.mem_stats) {
+        status = CRYPTO_set_mem_functions(direct_pool_malloc, direct_pool_realloc, direct_pool_free);
+    }
+    else {
+        if (opt.pool_alloc) {
+            base_malloc = pool_malloc;
+            base_realloc = pool_realloc;
+            base_free = pool_free;
+        }
+        status = CRYPTO_set_mem_functions(hook_malloc, hook_realloc, hook_free);
+    }
+    if (!status) {
+        fatal("cannot install memory hooks, OpenSSL already allocated memory");
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Get current statistics, reset the peak value to the current live size.
+//----------------------------------------------------------------------------
+
+MemStats mem_stats()
+{
+    MemStats st;
+    st.mallocs = mallocs.load(std::memory_order_relaxed);
+    st.reallocs = reallocs.load(std::memory_order_relaxed);
+    st.frees = frees.load(std::memory_order_relaxed);
+    st.bytes = bytes.load(std::memory_order_relaxed);
+    st.live = live.load(std::memory_order_relaxed);
+    st.peak = peak.load(std::memory_order_relaxed);
+    return st;
+}
+
+void mem_reset_peak()
+{
+    peak.store(live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+
+//----------------------------------------------------------------------------
+// Print allocation statistics of a test loop.
+//----------------------------------------------------------------------------
+
+void print_mem_stats(const char* name, uint64_t count, const MemStats& start, const MemStats& end)
+{
+    const double ops = double(count == 0 ? 1 : count);
+    std::printf("%s-mallocs-per-op: %.2f\n", name, double(end.mallocs - start.mallocs) / ops);
+    std::printf("%s-reallocs-per-op: %.2f\n", name, double(end.reallocs - start.reallocs) / ops);
+    std::printf("%s-frees-per-op: %.2f\n", name, double(end.frees - start.frees) / ops);
+    std::printf("%s-alloc-bytes-per-op: %.0f\n", name, double(end.bytes - start.bytes) / ops);
+    std::printf("%s-peak-live-bytes: %" PRId64 "\n", name, end.peak - start.live);
+    std::fflush(stdout);
+}
@@ -0,0 +1,655 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Built-in Montgomery engine: a reference implementation of the RSA
+// primitives, written in portable C++ with optional SIMD kernels. It is
+// used to separate the hardware performance from the quality of the
+// assembly code in OpenSSL. The paddings come from OpenSSL.
+//
+// - The private operation uses the CRT with a fixed-window exponentiation.
+//   All windows are processed and the table entries are read in constant time.
+// - The scalar kernel is a CIOS Montgomery multiplication on 64-bit digits
+//   with 128-bit products.
+// - The SIMD kernels (AVX2, Neon) use 28-bit digits in 64-bit lanes. The
+//   products are accumulated without carry propagation, which limits the
+//   size of the modulus, see MAX_DIGITS28. Above this size, the scalar kernel
+//   is used (typically the public operation with 4096-bit keys and above).
+// - The SIMD kernels are illustrative and not tuned: the accumulator is stored
+//   and reloaded for each digit of the multiplier and 28-bit digits need about
+//   five times more products than 64-bit ones. Depending on the CPU, they can
+//   be slower than the scalar kernel, even on the public operation.
+//
+// Each kernel is a separate backend: mont, mont-avx2, mont-neon. The SIMD
+// kernels are available when supported by the compiler and the CPU.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <memory>
+#include <openssl/bn.h>
+
+#if defined(__x86_64__)
+    #include <immintrin.h>
+    #define MONT_AVX2 1
+#elif defined(__aarch64__)
+    #include <arm_neon.h>
+    #define MONT_NEON 1
+#endif
+
+namespace {
+
+    using u128 = unsigned __int128;
+
+    // Montgomery multiplication kernels.
+    enum class MontKernel {SCALAR, AVX2, NEON};
+
+    // Size of digits in the SIMD kernels and max number of digits without overflow in 64-bit accumulators.
+    constexpr unsigned DIGIT_BITS28 = 28;
+    constexpr uint64_t MASK28 = (uint64_t(1) << DIGIT_BITS28) - 1;
+    constexpr size_t MAX_DIGITS28 = 112;
+
+    // Montgomery context for one odd modulus N, with R = 2^(digit_bits * digits).
+    // All values are arrays of little-endian digits, in 64-bit words.
+    class MontContext
+    {
+    public:
+        MontContext(const std::vector<uint8_t>& modulus, size_t size_bits, unsigned digit_bits, size_t pad);
+        virtual ~MontContext() = default;
+        MontContext(const MontContext&) = delete;
+        MontContext& operator=(const MontContext&) = delete;
+
+        // Check the kernel using values which are precomputed by OpenSSL. Abort on error.
+        void self_check();
+
+        // Number of digits in a value.
+        size_t digits() const { return _k; }
+
+        // Montgomery multiplication: r = a.b/R mod N, with a < R and b < N, r < N.
+        // The result may overwrite the operands.
+        virtual void mul(uint64_t* r, const uint64_t* a, const uint64_t* b) = 0;
+
+        // Convert a big-endian number, less than R^2, to Montgomery form.
+        void to_mont(uint64_t* r, const uint8_t* in, size_t size);
+
+        // Convert a value in Montgomery form to a big-endian number.
+        void from_mont(uint8_t* out, size_t size, const uint64_t* a);
+
+        // Load and store a value as big-endian number, without conversion.
+        void load(uint64_t* r, const uint8_t* in, size_t size) const;
+        void store(uint8_t* out, size_t size, const uint64_t* a) const;
+
+        // Modular subtraction, in constant time: r = a - b mod N.
+        void sub_mod(uint64_t* r, const uint64_t* a, const uint64_t* b);
+
+        // Exponentiation with a secret exponent of ebits bits (little-endian 64-bit words), in constant time.
+        // The base and the result are in Montgomery form, r and x must differ.
+        void exp_secret(uint64_t* r, const uint64_t* x, const uint64_t* e, size_t ebits);
+
+        // Exponentiation with a public exponent (left-to-right binary). Same forms, r and x must differ.
+        void exp_public(uint64_t* r, const uint64_t* x, const uint64_t* e, size_t ebits);
+
+        // Load and store big-endian numbers as arrays of digits of any size up to 64 bits.
+        static void load_digits(uint64_t* r, size_t count, unsigned bits, const uint8_t* in, size_t size);
+        static void store_digits(uint8_t* out, size_t size, const uint64_t* a, size_t count, unsigned bits);
+
+    protected:
+        const unsigned _bits;   // bits per digit
+        const uint64_t _mask;   // mask of a digit
+        const size_t   _k;      // number of digits, including padding
+        uint64_t       _n0inv;  // -N^-1 mod 2^bits
+        std::vector<uint64_t> _n {}, _r2 {}, _r3 {}, _one {}, _unit {};  // N, R^2 mod N, R^3 mod N, R mod N, 1
+        std::vector<uint64_t> _t {}, _s {}, _w {}, _x {}, _table {};     // work areas
+
+        // Reduce a value t < 2N, with an additional top digit, in constant time: r = t mod N.
+        void reduce(uint64_t* r, const uint64_t* t, uint64_t top);
+
+    private:
+        // Get a window of w bits at position pos in a little-endian array of 64-bit words.
+        static uint64_t window(const uint64_t* e, size_t words, size_t pos, unsigned w);
+    };
+
+    // Scalar kernel, 64-bit digits.
+    class ScalarContext : public MontContext
+    {
+    public:
+        ScalarContext(const std::vector<uint8_t>& modulus, size_t size_bits) : MontContext(modulus, size_bits, 64, 1) {}
+        virtual void mul(uint64_t* r, const uint64_t* a, const uint64_t* b) override;
+    };
+
+    // SIMD kernels, 28-bit digits.
+    class SIMDContext : public MontContext
+    {
+    public:
+        SIMDContext(const std::vector<uint8_t>& modulus, size_t size_bits, MontKernel kernel);
+        virtual void mul(uint64_t* r, const uint64_t* a, const uint64_t* b) override;
+    private:
+        const MontKernel _kernel;
+        std::vector<uint64_t> _acc {};
+    };
+
+    // RSA operation with the built-in engine.
+    class MontOperation : public RawOperation
+    {
+    public:
+        MontOperation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash, MontKernel kernel);
+
+    protected:
+        virtual void raw_private(const uint8_t* in, uint8_t* out) override;
+        virtual void raw_public(const uint8_t* in, uint8_t* out) override;
+
+    private:
+        const size_t _size;
+        size_t _pbits = 0, _qbits = 0, _ebits = 0;
+        std::unique_ptr<MontContext> _cn {}, _cp {}, _cq {};
+        std::vector<uint64_t> _e {}, _dp {}, _dq {}, _qinv {};     // exponents in 64-bit words, qinv in p digits
+        std::vector<uint64_t> _xn {}, _yn {}, _xp {}, _xq {}, _yp {}, _yq {};  // work areas
+        std::vector<uint8_t> _q {}, _mq {}, _h {};
+        std::vector<uint64_t> _wq {}, _wh {}, _wm {};              // CRT recombination in 64-bit words
+    };
+
+    class MontBackend : public Backend
+    {
+    public:
+        MontBackend(const std::string& name, MontKernel kernel, const std::string& description) :
+            _name(name), _kernel(kernel), _description(description) {}
+        virtual std::string name() const override
+        {
+            return _name;
+        }
+        virtual std::string version() const override
+        {
+            return "built-in Montgomery engine, " + _description;
+        }
+        virtual BackendOperation* new_operation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash) override
+        {
+            return new MontOperation(keys, type, pss_hash, _kernel);
+        }
+    private:
+        const std::string _name;
+        const MontKernel  _kernel;
+        const std::string _description;
+    };
+}
+
+std::vector<Backend*> new_mont_backends()
+{
+    std::vector<Backend*> list;
+    list.push_back(new MontBackend("mont", MontKernel::SCALAR, "scalar kernel, 64-bit digits"));
+#if defined(MONT_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        list.push_back(new MontBackend("mont-avx2", MontKernel::AVX2, "AVX2 kernel, 28-bit digits"));
+    }
+#elif defined(MONT_NEON)
+    list.push_back(new MontBackend("mont-neon", MontKernel::NEON, "Neon kernel, 28-bit digits"));
+#endif
+    return list;
+}
+
+
+//----------------------------------------------------------------------------
+// Montgomery context.
+//----------------------------------------------------------------------------
+
+MontContext::MontContext(const std::vector<uint8_t>& modulus, size_t size_bits, unsigned digit_bits, size_t pad) :
+    _bits(digit_bits),
+    _mask(digit_bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << digit_bits) - 1),
+    // With 64-bit digits, the CIOS algorithm accepts N < R. Otherwise, R > 4N to keep sums of two values in k digits.
+    _k(((digit_bits >= 64 ? (size_bits + 63) / 64 : (size_bits + 2 + digit_bits - 1) / digit_bits) + pad - 1) / pad * pad),
+    _n0inv(0),
+    _n(_k), _r2(_k), _r3(_k), _one(_k), _unit(_k),
+    _t(_k + 2), _s(_k), _w(2 * _k), _x(_k)
+{
+    load(_n.data(), modulus.data(), modulus.size());
+    _unit[0] = 1;
+
+    // -N^-1 mod 2^64 by Newton iterations, each one doubles the number of correct bits.
+    uint64_t inv = 1;
+    for (int i = 0; i < 6; i++) {
+        inv *= 2 - _n[0] * inv;
+    }
+    _n0inv = (0 - inv) & _mask;
+
+    // Constants in Montgomery form, computed by OpenSSL.
+    BN_CTX* ctx = BN_CTX_new();
+    BIGNUM* n = BN_bin2bn(modulus.data(), int(modulus.size()), nullptr);
+    BIGNUM* r = BN_new();
+    if (ctx == nullptr || n == nullptr || r == nullptr) {
+        fatal("error allocating BIGNUM");
+    }
+    std::vector<uint8_t> buf(modulus.size());
+    for (auto& cst : {std::make_pair(&_one, 1), std::make_pair(&_r2, 2), std::make_pair(&_r3, 3)}) {
+        BN_zero(r);
+        if (!BN_set_bit(r, int(cst.second * _bits * _k)) || !BN_mod(r, r, n, ctx) || BN_bn2binpad(r, buf.data(), int(buf.size())) < 0) {
+            fatal("error computing Montgomery constants");
+        }
+        load(cst.first->data(), buf.data(), buf.size());
+    }
+    BN_free(r);
+    BN_free(n);
+    BN_CTX_free(ctx);
+}
+
+void MontContext::self_check()
+{
+    // R^2.R^2/R = R^3 mod N, R^3.1/R = R^2 mod N
+    mul(_x.data(), _r2.data(), _r2.data());
+    const bool ok3 = _x == _r3;
+    mul(_x.data(), _r3.data(), _unit.data());
+    if (!ok3 || _x != _r2) {
+        fatal("Montgomery multiplication self-check failed");
+    }
+}
+
+void MontContext::load_digits(uint64_t* r, size_t count, unsigned bits, const uint8_t* in, size_t size)
+{
+    const uint64_t mask = bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+    u128 acc = 0;
+    unsigned acc_bits = 0;
+    size_t d = 0;
+    for (size_t i = size; i > 0 && d < count; i--) {
+        acc |= u128(in[i - 1]) << acc_bits;
+        acc_bits += 8;
+        if (acc_bits >= bits) {
+            r[d++] = uint64_t(acc) & mask;
+            acc >>= bits;
+            acc_bits -= bits;
+        }
+    }
+    if (d < count) {
+        r[d++] = uint64_t(acc) & mask;
+    }
+    std::fill(r + d, r + count, 0);
+}
+
+void MontContext::store_digits(uint8_t* out, size_t size, const uint64_t* a, size_t count, unsigned bits)
+{
+    u128 acc = 0;
+    unsigned acc_bits = 0;
+    size_t d = 0;
+    for (size_t i = size; i > 0; i--) {
+        if (acc_bits < 8 && d < count) {
+            acc |= u128(a[d++]) << acc_bits;
+            acc_bits += bits;
+        }
+        out[i - 1] = uint8_t(acc);
+        acc >>= 8;
+        acc_bits = acc_bits < 8 ? 0 : acc_bits - 8;
+    }
+}
+
+void MontContext::load(uint64_t* r, const uint8_t* in, size_t size) const
+{
+    load_digits(r, _k, _bits, in, size);
+}
+
+void MontContext::store(uint8_t* out, size_t size, const uint64_t* a) const
+{
+    store_digits(out, size, a, _k, _bits);
+}
+
+void MontContext::reduce(uint64_t* r, const uint64_t* t, uint64_t top)
+{
+    // s = t - N, keep t if the subtraction borrows.
+    uint64_t borrow = 0;
+    for (size_t j = 0; j < _k; j++) {
+        const u128 d = u128(t[j]) - _n[j] - borrow;
+        _s[j] = uint64_t(d) & _mask;
+        borrow = uint64_t(d >> 127);
+    }
+    const uint64_t keep = uint64_t(int64_t(top - borrow) >> 63);
+    for (size_t j = 0; j < _k; j++) {
+        r[j] = (t[j] & keep) | (_s[j] & ~keep);
+    }
+}
+
+void MontContext::sub_mod(uint64_t* r, const uint64_t* a, const uint64_t* b)
+{
+    uint64_t borrow = 0;
+    for (size_t j = 0; j < _k; j++) {
+        const u128 d = u128(a[j]) - b[j] - borrow;
+        _s[j] = uint64_t(d) & _mask;
+        borrow = uint64_t(d >> 127);
+    }
+    // Add N if negative.
+    const uint64_t add = 0 - borrow;
+    u128 carry = 0;
+    for (size_t j = 0; j < _k; j++) {
+        carry += u128(_s[j]) + (_n[j] & add);
+        r[j] = uint64_t(carry) & _mask;
+        carry >>= _bits;
+    }
+}
+
+void MontContext::to_mont(uint64_t* r, const uint8_t* in, size_t size)
+{
+    // in = hi.R + lo, in.R = hi.R^3/R + lo.R^2/R mod N
+    load_digits(_w.data(), 2 * _k, _bits, in, size);
+    mul(_x.data(), _w.data(), _r2.data());
+    mul(r, _w.data() + _k, _r3.data());
+    u128 carry = 0;
+    for (size_t j = 0; j < _k; j++) {
+        carry += u128(r[j]) + _x[j];
+        _t[j] = uint64_t(carry) & _mask;
+        carry >>= _bits;
+    }
+    reduce(r, _t.data(), uint64_t(carry));
+}
+
+void MontContext::from_mont(uint8_t* out, size_t size, const uint64_t* a)
+{
+    mul(_x.data(), a, _unit.data());
+    store(out, size, _x.data());
+}
+
+uint64_t MontContext::window(const uint64_t* e, size_t words, size_t pos, unsigned w)
+{
+    const size_t word = pos / 64;
+    const unsigned shift = pos % 64;
+    uint64_t value = word < words ? e[word] >> shift : 0;
+    if (shift + w > 64 && word + 1 < words) {
+        value |= e[word + 1] << (64 - shift);
+    }
+    return value & ((uint64_t(1) << w) - 1);
+}
+
+void MontContext::exp_secret(uint64_t* r, const uint64_t* x, const uint64_t* e, size_t ebits)
+{
+    const unsigned w = ebits > 512 ? 5 : 4;
+    const size_t entries = size_t(1) << w;
+    const size_t words = (ebits + 63) / 64;
+
+    // Table of x^i in Montgomery form.
+    _table.resize(entries * _k);
+    std::copy(_one.begin(), _one.end(), _table.begin());
+    std::copy(x, x + _k, _table.begin() + _k);
+    for (size_t i = 2; i < entries; i++) {
+        mul(&_table[i * _k], &_table[(i - 1) * _k], x);
+    }
+
+    // Read a table entry in constant time: all entries are read, one is kept.
+    const auto select = [&](uint64_t* dst, uint64_t index) {
+        std::fill(dst, dst + _k, 0);
+        for (size_t i = 0; i < entries; i++) {
+            const uint64_t diff = uint64_t(i) ^ index;
+            const uint64_t keep = ((diff | (0 - diff)) >> 63) - 1;
+            const uint64_t* entry = &_table[i * _k];
+            for (size_t j = 0; j < _k; j++) {
+                dst[j] |= entry[j] & keep;
+            }
+        }
+    };
+
+    // All windows are processed, from the top, whatever the value of the exponent.
+    size_t pos = (ebits + w - 1) / w * w - w;
+    select(r, window(e, words, pos, w));
+    while (pos > 0) {
+        pos -= w;
+        for (unsigned i = 0; i < w; i++) {
+            mul(r, r, r);
+        }
+        select(_x.data(), window(e, words, pos, w));
+        mul(r, r, _x.data());
+    }
+}
+
+void MontContext::exp_public(uint64_t* r, const uint64_t* x, const uint64_t* e, size_t ebits)
+{
+    std::copy(x, x + _k, r);
+    for (size_t bit = ebits - 1; bit > 0; bit--) {
+        mul(r, r, r);
+        if ((e[(bit - 1) / 64] >> ((bit - 1) % 64)) & 1) {
+            mul(r, r, x);
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Scalar kernel: CIOS Montgomery multiplication on 64-bit digits.
+//----------------------------------------------------------------------------
+
+void ScalarContext::mul(uint64_t* r, const uint64_t* a, const uint64_t* b)
+{
+    uint64_t* t = _t.data();
+    const uint64_t* n = _n.data();
+    std::fill(t, t + _k + 2, 0);
+
+    for (size_t i = 0; i < _k; i++) {
+        // t += a.b[i]
+        u128 c = 0;
+        for (size_t j = 0; j < _k; j++) {
+            c += u128(a[j]) * b[i] + t[j];
+            t[j] = uint64_t(c);
+            c >>= 64;
+        }
+        c += t[_k];
+        t[_k] = uint64_t(c);
+        t[_k + 1] = uint64_t(c >> 64);
+
+        // t = (t + m.N) / 2^64
+        const uint64_t m = t[0] * _n0inv;
+        c = (u128(m) * n[0] + t[0]) >> 64;
+        for (size_t j = 1; j < _k; j++) {
+            c += u128(m) * n[j] + t[j];
+            t[j - 1] = uint64_t(c);
+            c >>= 64;
+        }
+        c += t[_k];
+        t[_k - 1] = uint64_t(c);
+        t[_k] = t[_k + 1] + uint64_t(c >> 64);
+    }
+    reduce(r, t, t[_k]);
+}
+
+
+//----------------------------------------------------------------------------
+// SIMD kernels: operand scanning on 28-bit digits. For each digit b[i],
+// acc = (acc + a.b[i] + m.N) / 2^28 where m is chosen to clear the low digit.
+// The accumulators are not normalized, the division is a shift by one lane.
+//----------------------------------------------------------------------------
+
+#if defined(MONT_AVX2)
+
+// acc[4*blk...] + a[4*blk...] * bi + n[4*blk...] * mi
+__attribute__((target("avx2")))
+static inline __m256i mont28_avx2_block(const uint64_t* acc, const uint64_t* a, const uint64_t* n, size_t blk, __m256i bi, __m256i mi)
+{
+    const __m256i v = _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + 4 * blk)),
+                                       _mm256_mul_epu32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + 4 * blk)), bi));
+    return _mm256_add_epi64(v, _mm256_mul_epu32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(n + 4 * blk)), mi));
+}
+
+__attribute__((target("avx2")))
+static void mont28_avx2(uint64_t* acc, const uint64_t* a, const uint64_t* b, const uint64_t* n, uint64_t n0inv, size_t k)
+{
+    const size_t blocks = k / 4;
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (size_t i = 0; i < k; i++) {
+        const uint64_t m = ((acc[0] + a[0] * b[i]) * n0inv) & MASK28;
+        const __m256i bi = _mm256_set1_epi64x(int64_t(b[i]));
+        const __m256i mi = _mm256_set1_epi64x(int64_t(m));
+
+        // Rotate each block by one lane, the top lane comes from the next block.
+        const __m256i v0 = mont28_avx2_block(acc, a, n, 0, bi, mi);
+        const uint64_t carry = uint64_t(_mm_cvtsi128_si64(_mm256_castsi256_si128(v0))) >> DIGIT_BITS28;
+        __m256i prev = _mm256_permute4x64_epi64(v0, _MM_SHUFFLE(0, 3, 2, 1));
+        for (size_t blk = 1; blk < blocks; blk++) {
+            const __m256i rot = _mm256_permute4x64_epi64(mont28_avx2_block(acc, a, n, blk, bi, mi), _MM_SHUFFLE(0, 3, 2, 1));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + 4 * (blk - 1)), _mm256_blend_epi32(prev, rot, 0xC0));
+            prev = rot;
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + 4 * (blocks - 1)), _mm256_blend_epi32(prev, zero, 0xC0));
+        acc[0] += carry;
+    }
+}
+
+#endif
+
+#if defined(MONT_NEON)
+
+static void mont28_neon(uint64_t* acc, const uint64_t* a, const uint64_t* b, const uint64_t* n, uint64_t n0inv, size_t k)
+{
+    const size_t blocks = k / 2;
+    const uint64x2_t zero = vdupq_n_u64(0);
+
+    for (size_t i = 0; i < k; i++) {
+        const uint64_t m = ((acc[0] + a[0] * b[i]) * n0inv) & MASK28;
+        const uint32x2_t bi = vdup_n_u32(uint32_t(b[i]));
+        const uint32x2_t mi = vdup_n_u32(uint32_t(m));
+        const auto step = [&](size_t blk) {
+            const uint64x2_t v = vmlal_u32(vld1q_u64(acc + 2 * blk), vmovn_u64(vld1q_u64(a + 2 * blk)), bi);
+            return vmlal_u32(v, vmovn_u64(vld1q_u64(n + 2 * blk)), mi);
+        };
+
+        // Shift by one lane, the top lane comes from the next block.
+        uint64x2_t prev = step(0);
+        const uint64_t carry = vgetq_lane_u64(prev, 0) >> DIGIT_BITS28;
+        for (size_t blk = 1; blk < blocks; blk++) {
+            const uint64x2_t v = step(blk);
+            vst1q_u64(acc + 2 * (blk - 1), vextq_u64(prev, v, 1));
+            prev = v;
+        }
+        vst1q_u64(acc + 2 * (blocks - 1), vextq_u64(prev, zero, 1));
+        acc[0] += carry;
+    }
+}
+
+#endif
+
+SIMDContext::SIMDContext(const std::vector<uint8_t>& modulus, size_t size_bits, MontKernel kernel) :
+    MontContext(modulus, size_bits, DIGIT_BITS28, kernel == MontKernel::AVX2 ? 4 : 2),
+    _kernel(kernel),
+    _acc(_k)
+{
+}
+
+void SIMDContext::mul(uint64_t* r, const uint64_t* a, const uint64_t* b)
+{
+    std::fill(_acc.begin(), _acc.end(), 0);
+    switch (_kernel) {
+#if defined(MONT_AVX2)
+        case MontKernel::AVX2:
+            mont28_avx2(_acc.data(), a, b, _n.data(), _n0inv, _k);
+            break;
+#endif
+#if defined(MONT_NEON)
+        case MontKernel::NEON:
+            mont28_neon(_acc.data(), a, b, _n.data(), _n0inv, _k);
+            break;
+#endif
+        default:
+            fatal("Montgomery kernel not supported");
+    }
+
+    // Normalize the digits, the result is less than 2N.
+    uint64_t carry = 0;
+    for (size_t j = 0; j < _k; j++) {
+        const uint64_t d = _acc[j] + carry;
+        _t[j] = d & MASK28;
+        carry = d >> DIGIT_BITS28;
+    }
+    reduce(r, _t.data(), carry);
+}
+
+// Create a Montgomery context, using the scalar kernel when the SIMD kernel does not support the size.
+static MontContext* new_context(MontKernel kernel, const std::vector<uint8_t>& modulus, size_t size_bits)
+{
+    MontContext* ctx = nullptr;
+    if (kernel != MontKernel::SCALAR && (size_bits + 2 + DIGIT_BITS28 - 1) / DIGIT_BITS28 <= MAX_DIGITS28) {
+        ctx = new SIMDContext(modulus, size_bits, kernel);
+    }
+    else {
+        ctx = new ScalarContext(modulus, size_bits);
+    }
+    ctx->self_check();
+    return ctx;
+}
+
+
+//----------------------------------------------------------------------------
+// RSA operation with the built-in engine.
+//----------------------------------------------------------------------------
+
+// Big-endian number to little-endian 64-bit words, with one extra zero word.
+static std::vector<uint64_t> to_words(const std::vector<uint8_t>& bytes)
+{
+    std::vector<uint64_t> words((bytes.size() + 7) / 8 + 1);
+    MontContext::load_digits(words.data(), words.size(), 64, bytes.data(), bytes.size());
+    return words;
+}
+
+MontOperation::MontOperation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash, MontKernel kernel) :
+    RawOperation(keys, type, pss_hash),
+    _size(keys.size())
+{
+    const RSAKeyComponents comp(key_components(keys));
+    _pbits = bit_length(comp.p);
+    _qbits = bit_length(comp.q);
+    _ebits = bit_length(comp.e);
+
+    // Both CRT contexts use the size of the largest factor, to accept any input less than N.
+    const size_t crt_bits = std::max(_pbits, _qbits);
+    _cn.reset(new_context(kernel, comp.n, bit_length(comp.n)));
+    _cp.reset(new_context(kernel, comp.p, crt_bits));
+    _cq.reset(new_context(kernel, comp.q, crt_bits));
+
+    _e = to_words(comp.e);
+    _dp = to_words(comp.dp);
+    _dq = to_words(comp.dq);
+    _qinv.resize(_cp->digits());
+    _cp->load(_qinv.data(), comp.qinv.data(), comp.qinv.size());
+
+    _xn.resize(_cn->digits());
+    _yn.resize(_cn->digits());
+    _xp.resize(_cp->digits());
+    _yp.resize(_cp->digits());
+    _xq.resize(_cq->digits());
+    _yq.resize(_cq->digits());
+    _q = comp.q;
+    _mq.resize(comp.q.size());
+    _h.resize(comp.p.size());
+    _wq = to_words(_q);
+    _wh.resize(_wq.size());
+    _wm.resize(_wh.size() + _wq.size());
+    init();
+}
+
+void MontOperation::raw_public(const uint8_t* in, uint8_t* out)
+{
+    _cn->to_mont(_xn.data(), in, _size);
+    _cn->exp_public(_yn.data(), _xn.data(), _e.data(), _ebits);
+    _cn->from_mont(out, _size, _yn.data());
+}
+
+void MontOperation::raw_private(const uint8_t* in, uint8_t* out)
+{
+    // mp = c^dp mod p, mq = c^dq mod q, in Montgomery form.
+    _cp->to_mont(_xp.data(), in, _size);
+    _cp->exp_secret(_yp.data(), _xp.data(), _dp.data(), _pbits);
+    _cq->to_mont(_xq.data(), in, _size);
+    _cq->exp_secret(_yq.data(), _xq.data(), _dq.data(), _qbits);
+    _cq->from_mont(_mq.data(), _mq.size(), _yq.data());
+
+    // h = qinv.(mp - mq) mod p: the Montgomery product of (mp - mq).R and qinv is in normal form.
+    _cp->to_mont(_xp.data(), _mq.data(), _mq.size());
+    _cp->sub_mod(_xp.data(), _yp.data(), _xp.data());
+    _cp->mul(_xp.data(), _xp.data(), _qinv.data());
+    _cp->store(_h.data(), _h.size(), _xp.data());
+
+    // m = mq + h.q, on 64-bit words.
+    MontContext::load_digits(_wh.data(), _wh.size(), 64, _h.data(), _h.size());
+    MontContext::load_digits(_wm.data(), _wm.size(), 64, _mq.data(), _mq.size());
+    for (size_t i = 0; i < _wh.size(); i++) {
+        u128 c = 0;
+        for (size_t j = 0; j < _wq.size(); j++) {
+            c += u128(_wh[i]) * _wq[j] + _wm[i + j];
+            _wm[i + j] = uint64_t(c);
+            c >>= 64;
+        }
+        _wm[i + _wq.size()] = uint64_t(c);
+    }
+    MontContext::store_digits(out, _size, _wm.data(), _wm.size(), 64);
+}
@@ -0,0 +1,197 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Nettle crypto backend.
+//
+// The PSS signatures use the Nettle functions. OAEP is only available
+// since Nettle 3.10, with SHA-256 only. For consistency with the other
+// backends, the encryptions and decryptions use the OAEP padding from
+// OpenSSL with the Nettle RSA primitives: rsa_compute_root_tr() for the
+// private operation (CRT, with blinding) and the public exponentiation.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+
+#if defined(HAVE_NETTLE)
+
+#include <openssl/rand.h>
+#include <nettle/version.h>
+#include <nettle/rsa.h>
+#include <nettle/bignum.h>
+
+namespace {
+    class NettleOperation : public RawOperation
+    {
+    public:
+        NettleOperation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash);
+        virtual ~NettleOperation() override;
+        virtual void run() override;
+
+    protected:
+        virtual void raw_private(const uint8_t* in, uint8_t* out) override;
+        virtual void raw_public(const uint8_t* in, uint8_t* out) override;
+
+    private:
+        rsa_public_key  _pub;
+        rsa_private_key _priv;
+        int             _md_type;
+        std::vector<uint8_t> _salt {};
+        mpz_t _x, _y;  // work area
+    };
+
+    class NettleBackend : public Backend
+    {
+    public:
+        virtual std::string name() const override
+        {
+            return "nettle";
+        }
+        virtual std::string version() const override
+        {
+            return "Nettle " + std::to_string(nettle_version_major()) + "." + std::to_string(nettle_version_minor());
+        }
+        virtual BackendOperation* new_operation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash) override
+        {
+            return new NettleOperation(keys, type, pss_hash);
+        }
+    };
+}
+
+Backend* new_nettle_backend()
+{
+    return new NettleBackend;
+}
+
+
+//----------------------------------------------------------------------------
+// Random generator for Nettle, using OpenSSL.
+//----------------------------------------------------------------------------
+
+static void random_bytes(void* ctx, size_t length, uint8_t* dst)
+{
+    if (RAND_bytes(dst, int(length)) <= 0) {
+        fatal("RAND_bytes error");
+    }
+}
+
+static void set_mpz(mpz_t x, const std::vector<uint8_t>& bytes)
+{
+    nettle_mpz_set_str_256_u(x, bytes.size(), bytes.data());
+}
+
+
+//----------------------------------------------------------------------------
+// Prepare one operation.
+//----------------------------------------------------------------------------
+
+NettleOperation::NettleOperation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash) :
+    RawOperation(keys, type, pss_hash),
+    _md_type(EVP_MD_get_type(pss_hash)),
+    _salt(EVP_MD_get_size(pss_hash))
+{
+    if ((type == PSS_SIGN || type == PSS_VERIFY) && _md_type != NID_sha256 && _md_type != NID_sha384 && _md_type != NID_sha512) {
+        fatal(std::string("Nettle does not support PSS with ") + EVP_MD_get0_name(pss_hash));
+    }
+
+    // Nettle uses the same CRT coefficients as OpenSSL: a = dp, b = dq, c = q^-1 mod p.
+    const RSAKeyComponents comp(key_components(keys));
+    rsa_public_key_init(&_pub);
+    rsa_private_key_init(&_priv);
+    mpz_inits(_x, _y, nullptr);
+    set_mpz(_pub.n, comp.n);
+    set_mpz(_pub.e, comp.e);
+    set_mpz(_priv.d, comp.d);
+    set_mpz(_priv.p, comp.p);
+    set_mpz(_priv.q, comp.q);
+    set_mpz(_priv.a, comp.dp);
+    set_mpz(_priv.b, comp.dq);
+    set_mpz(_priv.c, comp.qinv);
+    if (!rsa_public_key_prepare(&_pub) || !rsa_private_key_prepare(&_priv)) {
+        fatal("invalid RSA key for Nettle");
+    }
+    init();
+}
+
+NettleOperation::~NettleOperation()
+{
+    mpz_clears(_x, _y, nullptr);
+    rsa_private_key_clear(&_priv);
+    rsa_public_key_clear(&_pub);
+}
+
+
+//----------------------------------------------------------------------------
+// Raw RSA operations.
+//----------------------------------------------------------------------------
+
+void NettleOperation::raw_private(const uint8_t* in, uint8_t* out)
+{
+    nettle_mpz_set_str_256_u(_x, _pub.size, in);
+    if (!rsa_compute_root_tr(&_pub, &_priv, nullptr, random_bytes, _y, _x)) {
+        fatal("RSA private operation error");
+    }
+    nettle_mpz_get_str_256(_pub.size, out, _y);
+}
+
+void NettleOperation::raw_public(const uint8_t* in, uint8_t* out)
+{
+    nettle_mpz_set_str_256_u(_x, _pub.size, in);
+    mpz_powm(_y, _x, _pub.e, _pub.n);
+    nettle_mpz_get_str_256(_pub.size, out, _y);
+}
+
+
+//----------------------------------------------------------------------------
+// Run the operation once. Native PSS, OAEP from the base class.
+//----------------------------------------------------------------------------
+
+void NettleOperation::run()
+{
+    int ok = 1;
+    switch (_type) {
+        case PSS_SIGN:
+            random_bytes(nullptr, _salt.size(), _salt.data());
+            switch (_md_type) {
+                case NID_sha256:
+                    ok = rsa_pss_sha256_sign_digest_tr(&_pub, &_priv, nullptr, random_bytes, _salt.size(), _salt.data(), _input.data(), _x);
+                    break;
+                case NID_sha384:
+                    ok = rsa_pss_sha384_sign_digest_tr(&_pub, &_priv, nullptr, random_bytes, _salt.size(), _salt.data(), _input.data(), _x);
+                    break;
+                default:
+                    ok = rsa_pss_sha512_sign_digest_tr(&_pub, &_priv, nullptr, random_bytes, _salt.size(), _salt.data(), _input.data(), _x);
+                    break;
+            }
+            if (!ok) {
+                fatal("RSA sign error");
+            }
+            nettle_mpz_get_str_256(_pub.size, _output.data(), _x);
+            _output_len = _pub.size;
+            break;
+        case PSS_VERIFY:
+            nettle_mpz_set_str_256_u(_x, _input.size(), _input.data());
+            switch (_md_type) {
+                case NID_sha256:
+                    ok = rsa_pss_sha256_verify_digest(&_pub, _salt.size(), _plain.data(), _x);
+                    break;
+                case NID_sha384:
+                    ok = rsa_pss_sha384_verify_digest(&_pub, _salt.size(), _plain.data(), _x);
+                    break;
+                default:
+                    ok = rsa_pss_sha512_verify_digest(&_pub, _salt.size(), _plain.data(), _x);
+                    break;
+            }
+            if (!ok) {
+                fatal("RSA verify error");
+            }
+            break;
+        default:
+            RawOperation::run();
+            break;
+    }
+}
+
+#endif // HAVE_NETTLE
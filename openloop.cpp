@@ -0,0 +1,319 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Open-loop latency tests.
+//
+// Requests are issued at a target arrival rate, either constant or Poisson,
+// into a pool of worker threads. The latency of each request is measured
+// from its intended start time, not from the time it was dequeued by a
+// worker. This way, the queueing delay is accounted when the workers are
+// late, avoiding the "coordinated omission" problem of closed-loop tests.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+
+// Offered loads, as fractions of the estimated capacity, when no rate is specified.
+static const double DEFAULT_LOADS[] = {0.10, 0.25, 0.50, 0.70, 0.80, 0.90, 0.95, 1.00, 1.10};
+
+// Duration of the capacity estimation.
+constexpr int64_t CALIBRATION_TIME = USECPERSEC / 5;
+
+
+//----------------------------------------------------------------------------
+// Estimate the capacity of the worker pool for one operation, in op/s.
+//----------------------------------------------------------------------------
+
+static double estimate_capacity(const RSAKeys& keys, RSAOpType type)
+{
+    RSAOperation op(keys, type);
+    uint64_t count = 0;
+    uint64_t duration = 0;
+    const int64_t start = wall_time_ns();
+
+    do {
+        for (size_t i = 0; i < INNER_LOOP_COUNT; i++) {
+            op.run();
+            count++;
+        }
+        duration = (wall_time_ns() - start) / 1000;
+    } while (duration < CALIBRATION_TIME);
+
+    const size_t parallel = std::min(opt.workers, cpu_count());
+    return double(parallel * USECPERSEC * count) / double(duration);
+}
+
+
+//----------------------------------------------------------------------------
+// One class of requests in a load: operation on a key pair, with a weight.
+//----------------------------------------------------------------------------
+
+namespace {
+    struct LoadClass
+    {
+        const RSAKeys* keys;
+        RSAOpType      type;
+        double         weight;
+    };
+}
+
+
+//----------------------------------------------------------------------------
+// Run one load point. Each request is randomly assigned to a class, according
+// to the weights. Return the latencies of each class. Return the elapsed time
+// in nanoseconds in elapsed.
+//----------------------------------------------------------------------------
+
+static std::vector<std::vector<int64_t>> run_load_point(const std::vector<LoadClass>& classes, double rate, int64_t& elapsed)
+{
+    // Queue of pending requests, each one is represented by its intended start time and class.
+    std::deque<std::pair<int64_t, size_t>> queue;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done = false;
+
+    // Prepare the operations and latencies of each worker before starting.
+    std::vector<std::vector<std::unique_ptr<RSAOperation>>> ops(opt.workers);
+    std::vector<std::vector<std::vector<int64_t>>> latencies(opt.workers, std::vector<std::vector<int64_t>>(classes.size()));
+    std::vector<int64_t> last_end(opt.workers, 0);
+    for (size_t i = 0; i < opt.workers; i++) {
+        for (size_t c = 0; c < classes.size(); c++) {
+            ops[i].emplace_back(new RSAOperation(*classes[c].keys, classes[c].type));
+            latencies[i][c].reserve(size_t(rate * opt.duration / USECPERSEC / opt.workers / classes.size()) + 1024);
+        }
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < opt.workers; i++) {
+        workers.emplace_back([&, i]() {
+            for (;;) {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&]() { return done || !queue.empty(); });
+                if (queue.empty()) {
+                    break;
+                }
+                const int64_t intended = queue.front().first;
+                const size_t c = queue.front().second;
+                queue.pop_front();
+                lock.unlock();
+                ops[i][c]->run();
+                last_end[i] = wall_time_ns();
+                latencies[i][c].push_back(last_end[i] - intended);
+            }
+        });
+    }
+
+    // Generate the requests at their intended start time. When the generator is late,
+    // all overdue requests are queued at once, with their original intended time.
+    std::mt19937_64 rng(0x5A5A5A5A);
+    std::exponential_distribution<double> interval(rate);
+    std::vector<double> weights;
+    for (const auto& cl : classes) {
+        weights.push_back(cl.weight);
+    }
+    std::discrete_distribution<size_t> select(weights.begin(), weights.end());
+    const int64_t start = wall_time_ns() + NSECPERSEC / 1000;
+    const int64_t end = start + opt.duration * 1000;
+    double next = double(start);
+
+    while (int64_t(next) < end) {
+        const int64_t now = wall_time_ns();
+        if (int64_t(next) > now) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(int64_t(next) - now));
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (int64_t(next) <= now && int64_t(next) < end) {
+                queue.push_back(std::make_pair(int64_t(next), classes.size() > 1 ? select(rng) : 0));
+                next += opt.poisson ? interval(rng) * NSECPERSEC : NSECPERSEC / rate;
+            }
+        }
+        cond.notify_all();
+    }
+
+    // Wait for all pending requests to complete.
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    cond.notify_all();
+    for (auto& th : workers) {
+        th.join();
+    }
+
+    // Collect latencies per class.
+    std::vector<std::vector<int64_t>> result(classes.size());
+    for (const auto& wlat : latencies) {
+        for (size_t c = 0; c < classes.size(); c++) {
+            result[c].insert(result[c].end(), wlat[c].begin(), wlat[c].end());
+        }
+    }
+    elapsed = *std::max_element(last_end.begin(), last_end.end()) - start;
+    return result;
+}
+
+
+//----------------------------------------------------------------------------
+// Run open-loop latency tests.
+//----------------------------------------------------------------------------
+
+void open_loop_tests()
+{
+    // Default operations: the ones which are typically served by a signing or decryption service.
+    std::vector<std::string> op_names(opt.ops);
+    if (op_names.empty()) {
+        op_names = {op_name(OAEP_DECRYPT), op_name(PSS_SIGN), op_name(PSS_VERIFY)};
+    }
+
+    std::cout << "openloop-arrival: " << (opt.poisson ? "poisson" : "constant") << std::endl;
+    std::cout << "openloop-workers: " << opt.workers << std::endl;
+    std::cout << "openloop-duration-usec: " << opt.duration << std::endl;
+    if (opt.slo_p99 > 0.0) {
+        std::cout << "openloop-slo-p99-usec: " << opt.slo_p99 << std::endl;
+    }
+    std::cout << "openloop-columns: op algo offered achieved p50 p90 p99 p999 max" << std::endl;
+
+    for (const auto& key_name : opt.keys) {
+        const RSAKeys keys("rsa-" + key_name);
+        for (const auto& name : op_names) {
+            const RSAOpType type = op_type(name);
+
+            // Compute the list of offered loads.
+            std::vector<double> rates(opt.rates);
+            if (rates.empty()) {
+                const double capacity = estimate_capacity(keys, type);
+                std::cout << "openloop-capacity: " << name << " " << keys.algo() << " " << int64_t(capacity) << std::endl;
+                for (double load : DEFAULT_LOADS) {
+                    rates.push_back(std::max(1.0, std::round(load * capacity)));
+                }
+            }
+            std::sort(rates.begin(), rates.end());
+
+            // Run all load points, find the first one which breaks the SLO.
+            double slo_max = 0.0;
+            bool slo_broken = false;
+            for (double rate : rates) {
+                int64_t elapsed = 0;
+                std::vector<std::vector<int64_t>> latencies(run_load_point({{&keys, type, 1.0}}, rate, elapsed));
+                const LatencyStats pt(latencies.front());
+                const double achieved = elapsed <= 0 ? 0.0 : double(NSECPERSEC) * pt.count / double(elapsed);
+                std::printf("openloop-point: %s %s %.0f %.0f %.1f %.1f %.1f %.1f %.1f\n",
+                            name.c_str(), keys.algo().c_str(), rate, achieved, pt.p50, pt.p90, pt.p99, pt.p999, pt.max);
+                std::fflush(stdout);
+                if (opt.slo_p99 > 0.0 && !slo_broken) {
+                    if (pt.p99 <= opt.slo_p99) {
+                        slo_max = rate;
+                    }
+                    else {
+                        slo_broken = true;
+                    }
+                }
+            }
+            if (opt.slo_p99 > 0.0) {
+                std::cout << "openloop-slo-max-load: " << name << " " << keys.algo() << " " << int64_t(slo_max) << std::endl;
+            }
+        }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Run a mixed workload: each request is a random operation, according to the
+// weights of the operations. All operations share the same worker pool, the
+// fast public key operations queue behind the slow private key operations.
+//----------------------------------------------------------------------------
+
+void mixed_tests()
+{
+    // Load all key pairs once.
+    std::map<std::string, std::unique_ptr<RSAKeys>> keys;
+    std::vector<LoadClass> classes;
+    std::vector<std::string> names;
+    double total_weight = 0.0;
+    for (const auto& entry : opt.mix) {
+        auto& k(keys[entry.key]);
+        if (k == nullptr) {
+            k.reset(new RSAKeys("rsa-" + entry.key));
+        }
+        classes.push_back({k.get(), op_type(entry.op), entry.weight});
+        names.push_back(entry.op + "/" + k->algo());
+        total_weight += entry.weight;
+    }
+    if (total_weight <= 0.0) {
+        fatal("invalid mixed workload, all weights are zero");
+    }
+
+    std::cout << "mixed-arrival: " << (opt.poisson ? "poisson" : "constant") << std::endl;
+    std::cout << "mixed-workers: " << opt.workers << std::endl;
+    std::cout << "mixed-duration-usec: " << opt.duration << std::endl;
+    for (size_t c = 0; c < classes.size(); c++) {
+        std::printf("mixed-class: %s %.1f%%\n", names[c].c_str(), 100.0 * classes[c].weight / total_weight);
+    }
+    if (opt.slo_p99 > 0.0) {
+        std::cout << "mixed-slo-p99-usec: " << opt.slo_p99 << std::endl;
+    }
+
+    // Compute the list of offered loads. The capacity of the mix is the weighted harmonic mean.
+    std::vector<double> rates(opt.rates);
+    if (rates.empty()) {
+        double time_per_op = 0.0;
+        for (const auto& cl : classes) {
+            time_per_op += cl.weight / total_weight / estimate_capacity(*cl.keys, cl.type);
+        }
+        const double capacity = 1.0 / time_per_op;
+        std::cout << "mixed-capacity: " << int64_t(capacity) << std::endl;
+        for (double load : DEFAULT_LOADS) {
+            rates.push_back(std::max(1.0, std::round(load * capacity)));
+        }
+    }
+    std::sort(rates.begin(), rates.end());
+
+    // Run all load points. Report the aggregate throughput and latency, then each operation.
+    std::cout << "mixed-columns: op offered achieved p50 p90 p99 p999 max" << std::endl;
+    double slo_max = 0.0;
+    bool slo_broken = false;
+    for (double rate : rates) {
+        int64_t elapsed = 0;
+        std::vector<std::vector<int64_t>> latencies(run_load_point(classes, rate, elapsed));
+        std::vector<int64_t> all;
+        for (const auto& lat : latencies) {
+            all.insert(all.end(), lat.begin(), lat.end());
+        }
+        const auto print_point = [&](const std::string& name, double offered, std::vector<int64_t>& lat) {
+            const LatencyStats pt(lat);
+            const double achieved = elapsed <= 0 ? 0.0 : double(NSECPERSEC) * pt.count / double(elapsed);
+            std::printf("mixed-point: %s %.0f %.0f %.1f %.1f %.1f %.1f %.1f\n",
+                        name.c_str(), offered, achieved, pt.p50, pt.p90, pt.p99, pt.p999, pt.max);
+            return pt;
+        };
+        const LatencyStats total(print_point("all", rate, all));
+        for (size_t c = 0; c < classes.size(); c++) {
+            print_point(names[c], rate * classes[c].weight / total_weight, latencies[c]);
+        }
+        std::fflush(stdout);
+        if (opt.slo_p99 > 0.0 && !slo_broken) {
+            if (total.p99 <= opt.slo_p99) {
+                slo_max = rate;
+            }
+            else {
+                slo_broken = true;
+            }
+        }
+    }
+    if (opt.slo_p99 > 0.0) {
+        std::cout << "mixed-slo-max-load: " << int64_t(slo_max) << std::endl;
+    }
+}
@@ -0,0 +1,434 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Hardware performance counters, using Linux perf_event_open().
+//
+// The counters are opened for the calling thread, in user mode only, so that
+// they remain available with the default perf_event_paranoid setting. The
+// events are grouped so that the ratios are computed on the same time slices.
+// The generic events are always requested. The top-down events are found
+// in sysfs, when the PMU exposes them:
+//
+// - Intel Ice Lake and later: slots, topdown-{retiring,bad-spec,fe-bound,be-bound}.
+// - Intel Skylake to Cascade Lake: topdown-{total-slots,slots-issued,slots-retired,
+//   fetch-bubbles,recovery-bubbles}, level 1 of the top-down method.
+// - Arm: stall_frontend, stall_backend, relative to the cycles.
+//
+// All missing events are silently ignored. When no counter can be opened,
+// a warning is displayed once and no counter value is reported.
+//
+// The effective CPU frequency is computed from the cycles of the test thread(s)
+// and their running time. Without cycles counter, the frequency during the test
+// is unknown. A dependency chain of additions, one cycle each on all supported
+// cores, can be timed after the test, as an indication only.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <atomic>
+#include <fstream>
+#include <filesystem>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#if defined(__linux__)
+    #include <unistd.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <linux/perf_event.h>
+#endif
+
+namespace {
+    // Description of one event.
+    struct PerfEvent
+    {
+        std::string name {};
+        uint32_t type = 0;
+        uint64_t config = 0;
+        uint64_t config1 = 0;
+        uint64_t config2 = 0;
+        double   scale = 1.0;
+    };
+
+    // A group of events, the first one is the group leader.
+    using PerfEventGroup = std::vector<PerfEvent>;
+}
+
+
+//----------------------------------------------------------------------------
+// Sysfs PMU event descriptions.
+//----------------------------------------------------------------------------
+
+#if defined(__linux__)
+
+static const std::string PMU_ROOT("/sys/bus/event_source/devices");
+
+// Read the first line of a text file, empty on error.
+static std::string read_line(const std::string& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// Store a value in a config field, as described by a format file ("config:0-7,21").
+static bool set_format_field(PerfEvent& event, const std::string& format, uint64_t value)
+{
+    const size_t colon = format.find(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    const std::string field(format.substr(0, colon));
+    uint64_t* config = field == "config" ? &event.config : (field == "config1" ? &event.config1 : (field == "config2" ? &event.config2 : nullptr));
+    if (config == nullptr) {
+        return false;
+    }
+    // The bits of the value are spread over the successive ranges.
+    size_t start = colon + 1;
+    for (;;) {
+        const size_t comma = format.find(',', start);
+        const std::string range(format.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+        const size_t dash = range.find('-');
+        const int first = std::atoi(range.c_str());
+        const int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+        for (int bit = first; bit <= last && bit < 64; bit++) {
+            *config |= (value & 1) << bit;
+            value >>= 1;
+        }
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    return true;
+}
+
+// Get an event from a PMU in sysfs ("event=0x3c,umask=0x00,any=1").
+static bool sysfs_event(const std::string& pmu, const std::string& name, PerfEvent& event)
+{
+    const std::string dir(PMU_ROOT + "/" + pmu);
+    const std::string spec(read_line(dir + "/events/" + name));
+    const std::string type(read_line(dir + "/type"));
+    if (spec.empty() || type.empty()) {
+        return false;
+    }
+    event = PerfEvent();
+    event.name = name;
+    event.type = uint32_t(std::atoi(type.c_str()));
+    const std::string scale(read_line(dir + "/events/" + name + ".scale"));
+    if (!scale.empty()) {
+        event.scale = std::strtod(scale.c_str(), nullptr);
+    }
+    size_t start = 0;
+    for (;;) {
+        const size_t comma = spec.find(',', start);
+        const std::string term(spec.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+        const size_t equal = term.find('=');
+        const std::string key(term.substr(0, equal));
+        const uint64_t value = equal == std::string::npos ? 1 : std::strtoull(term.c_str() + equal + 1, nullptr, 0);
+        if (!key.empty() && !set_format_field(event, read_line(dir + "/format/" + key), value)) {
+            return false;
+        }
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    return true;
+}
+
+// Build a group from sysfs events of the first PMU which has all of them.
+static bool sysfs_group(const std::vector<std::string>& names, PerfEventGroup& group)
+{
+    std::error_code err;
+    for (const auto& entry : std::filesystem::directory_iterator(PMU_ROOT, err)) {
+        const std::string pmu(entry.path().filename());
+        group.clear();
+        for (const auto& name : names) {
+            PerfEvent event;
+            if (!sysfs_event(pmu, name, event)) {
+                break;
+            }
+            group.push_back(event);
+        }
+        if (group.size() == names.size()) {
+            return true;
+        }
+    }
+    group.clear();
+    return false;
+}
+
+// Get the list of event groups to open, computed once.
+static const std::vector<PerfEventGroup>& event_groups()
+{
+    static const std::vector<PerfEventGroup> groups([]() {
+        std::vector<PerfEventGroup> list;
+
+        // Generic hardware events.
+        const auto hw = [](const char* name, uint64_t config) {
+            PerfEvent event;
+            event.name = name;
+            event.type = PERF_TYPE_HARDWARE;
+            event.config = config;
+            return event;
+        };
+        list.push_back({hw("cycles", PERF_COUNT_HW_CPU_CYCLES),
+                        hw("instructions", PERF_COUNT_HW_INSTRUCTIONS),
+                        hw("cache-misses", PERF_COUNT_HW_CACHE_MISSES),
+                        hw("branch-misses", PERF_COUNT_HW_BRANCH_MISSES)});
+
+        // Top-down events, in a separate group: the slots event must be the leader on Intel.
+        PerfEventGroup topdown;
+        if (sysfs_group({"slots", "topdown-retiring", "topdown-bad-spec", "topdown-fe-bound", "topdown-be-bound"}, topdown) ||
+            sysfs_group({"topdown-total-slots", "topdown-slots-issued", "topdown-slots-retired", "topdown-fetch-bubbles", "topdown-recovery-bubbles"}, topdown) ||
+            sysfs_group({"cpu_cycles", "stall_frontend", "stall_backend"}, topdown))
+        {
+            list.push_back(topdown);
+        }
+        return list;
+    }());
+    return groups;
+}
+
+static long perf_event_open(perf_event_attr* attr, pid_t pid, int cpu, int group_fd, unsigned long flags)
+{
+    return ::syscall(__NR_perf_event_open, attr, pid, cpu, group_fd, flags);
+}
+
+#endif // __linux__
+
+
+//----------------------------------------------------------------------------
+// Open the counters for the calling thread.
+//----------------------------------------------------------------------------
+
+PerfCounters::PerfCounters(bool cycles_only)
+{
+#if defined(__linux__)
+    static std::atomic<bool> warned(false);
+    int error = 0;
+
+    for (const auto& events : event_groups()) {
+        Group group;
+        for (const auto& event : events) {
+            if (cycles_only && event.name != "cycles") {
+                continue;
+            }
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = event.type;
+            attr.config = event.config;
+            attr.config1 = event.config1;
+            attr.config2 = event.config2;
+            attr.disabled = group.fds.empty();
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            const int fd = int(perf_event_open(&attr, 0, -1, group.fds.empty() ? -1 : group.fds.front(), 0));
+            if (fd >= 0) {
+                group.fds.push_back(fd);
+                group.events.push_back(std::make_pair(event.name, event.scale));
+            }
+            else if (group.fds.empty()) {
+                error = errno;
+                break;  // no group leader, skip the group
+            }
+        }
+        if (!group.fds.empty()) {
+            _groups.push_back(group);
+        }
+    }
+
+    if (_groups.empty() && !cycles_only && !warned.exchange(true)) {
+        std::cerr << "rsabench: performance counters unavailable: " << std::strerror(error) << std::endl;
+    }
+#else
+    static std::atomic<bool> warned(false);
+    if (!cycles_only && !warned.exchange(true)) {
+        std::cerr << "rsabench: performance counters are only supported on Linux" << std::endl;
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#if defined(__linux__)
+    for (const auto& group : _groups) {
+        for (int fd : group.fds) {
+            ::close(fd);
+        }
+    }
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Start and stop counting.
+//----------------------------------------------------------------------------
+
+void PerfCounters::start()
+{
+#if defined(__linux__)
+    for (const auto& group : _groups) {
+        ::ioctl(group.fds.front(), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(group.fds.front(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+PerfValues PerfCounters::stop()
+{
+    PerfValues values;
+#if defined(__linux__)
+    for (const auto& group : _groups) {
+        ::ioctl(group.fds.front(), PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        // Read format: nr, time_enabled, time_running, values[nr].
+        std::vector<uint64_t> data(3 + group.fds.size(), 0);
+        const ssize_t size = ::read(group.fds.front(), data.data(), data.size() * sizeof(uint64_t));
+        if (size < ssize_t(3 * sizeof(uint64_t)) || data[0] != group.fds.size() || data[2] == 0) {
+            continue;
+        }
+        // Extrapolate multiplexed counters.
+        const double ratio = double(data[1]) / double(data[2]);
+        for (size_t i = 0; i < group.events.size(); i++) {
+            values[group.events[i].first] = double(data[3 + i]) * group.events[i].second * ratio;
+        }
+        if (group.events.front().first == "cycles") {
+            values["time-enabled-ns"] = double(data[1]);  // thread time, for the effective frequency
+        }
+    }
+#endif
+    return values;
+}
+
+
+//----------------------------------------------------------------------------
+// Accumulate counter values from several threads.
+//----------------------------------------------------------------------------
+
+void add_perf_values(PerfValues& total, const PerfValues& values)
+{
+    for (const auto& val : values) {
+        total[val.first] += val.second;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Print the counter values of a test loop.
+//----------------------------------------------------------------------------
+
+void print_perf_values(const char* name, uint64_t count, const PerfValues& values)
+{
+    const auto get = [&values](const char* event) {
+        const auto it = values.find(event);
+        return it == values.end() ? 0.0 : it->second;
+    };
+    const double ops = double(count == 0 ? 1 : count);
+    const double cycles = get("cycles");
+    const double instructions = get("instructions");
+
+    if (cycles > 0.0) {
+        std::printf("%s-cycles-per-op: %.0f\n", name, cycles / ops);
+    }
+    if (instructions > 0.0) {
+        std::printf("%s-instructions-per-op: %.0f\n", name, instructions / ops);
+    }
+    if (cycles > 0.0 && instructions > 0.0) {
+        std::printf("%s-ipc: %.2f\n", name, instructions / cycles);
+    }
+    if (values.count("cache-misses") > 0) {
+        std::printf("%s-cache-misses-per-op: %.2f\n", name, get("cache-misses") / ops);
+    }
+    if (values.count("branch-misses") > 0) {
+        std::printf("%s-branch-misses-per-op: %.2f\n", name, get("branch-misses") / ops);
+    }
+
+    // Top-down level 1, in percent of the pipeline slots (or cycles on Arm).
+    double frontend = -1.0, bad_spec = -1.0, backend = -1.0, retiring = -1.0;
+    if (get("slots") > 0.0) {
+        const double slots = get("slots");
+        frontend = get("topdown-fe-bound") / slots;
+        bad_spec = get("topdown-bad-spec") / slots;
+        backend = get("topdown-be-bound") / slots;
+        retiring = get("topdown-retiring") / slots;
+    }
+    else if (get("topdown-total-slots") > 0.0) {
+        const double slots = get("topdown-total-slots");
+        frontend = get("topdown-fetch-bubbles") / slots;
+        bad_spec = (get("topdown-slots-issued") - get("topdown-slots-retired") + get("topdown-recovery-bubbles")) / slots;
+        retiring = get("topdown-slots-retired") / slots;
+        backend = 1.0 - frontend - bad_spec - retiring;
+    }
+    else if (get("cpu_cycles") > 0.0) {
+        frontend = get("stall_frontend") / get("cpu_cycles");
+        backend = get("stall_backend") / get("cpu_cycles");
+    }
+    if (frontend >= 0.0) {
+        std::printf("%s-topdown-frontend-percent: %.1f\n", name, 100.0 * frontend);
+    }
+    if (bad_spec >= 0.0) {
+        std::printf("%s-topdown-bad-spec-percent: %.1f\n", name, 100.0 * bad_spec);
+    }
+    if (backend >= 0.0) {
+        std::printf("%s-topdown-backend-percent: %.1f\n", name, 100.0 * backend);
+    }
+    if (retiring >= 0.0) {
+        std::printf("%s-topdown-retiring-percent: %.1f\n", name, 100.0 * retiring);
+    }
+    std::fflush(stdout);
+}
+
+
+//----------------------------------------------------------------------------
+// CPU frequency in MHz after a test, measured with a calibrated busy loop.
+//----------------------------------------------------------------------------
+
+double post_test_mhz()
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+    constexpr uint64_t CHAIN = 100;      // dependent additions per iteration
+    constexpr uint64_t ITERATIONS = 1000;
+    constexpr int64_t  DURATION = 5 * NSECPERSEC / 1000;
+
+    // Register operands: recent cores may fold additions of immediate values at renaming.
+    uint64_t x = 0;
+    uint64_t y = 1;
+    uint64_t adds = 0;
+    const int64_t start = wall_time_ns();
+    int64_t elapsed = 0;
+    do {
+        for (uint64_t i = 0; i < ITERATIONS; i++) {
+#if defined(__aarch64__)
+            asm volatile(".rept 100\n\tadd %0, %0, %1\n\t.endr" : "+r" (x) : "r" (y));
+#else
+            asm volatile(".rept 100\n\tadd %1, %0\n\t.endr" : "+r" (x) : "r" (y));
+#endif
+        }
+        adds += CHAIN * ITERATIONS;
+        elapsed = wall_time_ns() - start;
+    } while (elapsed < DURATION);
+    return 1000.0 * double(adds) / double(elapsed);
+#else
+    return 0.0;
+#endif
+}
+
+
+//----------------------------------------------------------------------------
+// Effective CPU frequency in MHz during a test loop.
+//----------------------------------------------------------------------------
+
+double effective_mhz(const PerfValues& values)
+{
+    const auto cycles = values.find("cycles");
+    const auto time = values.find("time-enabled-ns");
+    return cycles != values.end() && time != values.end() && cycles->second > 0.0 && time->second > 0.0 ?
+        1000.0 * cycles->second / time->second : 0.0;
+}
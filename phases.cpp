@@ -0,0 +1,252 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Breakdown of the time of an RSA operation in phases.
+//
+// Each phase is timed separately, in its own loop, using the low-level
+// padding functions and the raw RSA operation (no padding) of OpenSSL:
+//
+// - hash: message digest of the data to sign or verify, by the application.
+// - rng: random draws of the padding (OAEP seed, PSS salt of the digest size).
+// - encode: OAEP or PSS encoding or decoding, without the random draws.
+// - convert: byte array to BIGNUM and back.
+// - modexp: raw RSA, without the conversions. The private key operations
+//   include the blinding and the CRT.
+// - other: the rest of the complete EVP operation (provider dispatch,
+//   parameter checks, memory allocations). This is the difference between
+//   the complete operation and the sum of the other phases.
+//
+// The complete operation is timed before and after the phases. The total is
+// the mean of the two and the noise is their relative difference. A residual
+// which is smaller than the noise, including a negative one, is not
+// significant.
+//
+// The padding functions use explicitly fetched digests, as the provider
+// does. With the legacy EVP_MD constants, each call would fetch the digest
+// again and the encoding would be slower than in the EVP operation.
+//
+//----------------------------------------------------------------------------
+
+// Low-level padding functions and raw RSA are deprecated but still the only way to isolate the phases.
+#define OPENSSL_SUPPRESS_DEPRECATED 1
+
+#include "rsabench.h"
+#include <functional>
+#include <memory>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+#include <openssl/rsa.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+
+namespace {
+    // Phase names, in order of display.
+    const std::vector<std::string> PHASES {"hash", "rng", "encode", "convert", "modexp", "other"};
+
+    // Duration in nanoseconds per phase, plus total.
+    struct PhaseTimes
+    {
+        std::string test {};
+        double total = 0.0;
+        double noise = 0.0;   // relative difference between two measurements of the total
+        std::map<std::string, double> phases {};
+
+        // Duration of a phase, zero if not applicable.
+        double phase(const std::string& name) const
+        {
+            const auto it = phases.find(name);
+            return it == phases.end() ? 0.0 : it->second;
+        }
+    };
+
+    // Fetch a digest by name from the default providers.
+    EVP_MD* fetch_md(const char* name)
+    {
+        EVP_MD* md = EVP_MD_fetch(nullptr, name, nullptr);
+        if (md == nullptr) {
+            fatal(std::string("error fetching ") + name);
+        }
+        return md;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Average CPU time of a function in nanoseconds.
+//----------------------------------------------------------------------------
+
+static double time_ns(const std::function<void()>& func)
+{
+    // All phases of an operation share the test duration.
+    const int64_t min_time = std::max<int64_t>(opt.loop_time / 8, 1000);
+    uint64_t count = 0;
+    int64_t duration = 0;
+    const int64_t start = cpu_time();
+    do {
+        for (size_t i = 0; i < INNER_LOOP_COUNT; i++) {
+            func();
+        }
+        count += INNER_LOOP_COUNT;
+        duration = cpu_time() - start;
+    } while (duration < min_time);
+    return 1000.0 * double(duration) / double(count);
+}
+
+
+//----------------------------------------------------------------------------
+// Time the phases of one operation.
+//----------------------------------------------------------------------------
+
+static PhaseTimes time_phases(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash)
+{
+    // Same digests as the provider: PSS hash for PSS and MGF1, SHA-1 for OAEP and MGF1.
+    EVP_MD* md = fetch_md(EVP_MD_get0_name(pss_hash));
+    EVP_MD* sha1 = fetch_md("SHA1");
+    RSA* rsa = const_cast<RSA*>(EVP_PKEY_get0_RSA(keys.priv()));
+    const int k = int(keys.size());
+    const size_t hlen = EVP_MD_get_size(md);
+    std::vector<uint8_t> message(keys.size() / 2, 0xA5);
+    std::vector<uint8_t> digest(EVP_MAX_MD_SIZE);
+    std::vector<uint8_t> plain(keys.size() / 2, 0xA5);
+    std::vector<uint8_t> padded(keys.size());
+    std::vector<uint8_t> raw(keys.size());
+    std::vector<uint8_t> out(keys.size());
+    std::vector<uint8_t> random(keys.size());
+    if (!EVP_Digest(message.data(), message.size(), digest.data(), nullptr, md, nullptr)) {
+        fatal("EVP_Digest error");
+    }
+
+    PhaseTimes res;
+    res.test = keys.algo() + " " + op_name(type);
+
+    // Complete EVP operation, as in the throughput tests, plus hash of the message.
+    std::unique_ptr<BackendOperation> op(new RSAOperation(keys, type, pss_hash));
+    const double total1 = time_ns([&]() { op->run(); });
+
+    // Hash of the message, before a signature or a verification.
+    if (type == PSS_SIGN || type == PSS_VERIFY) {
+        res.phases["hash"] = time_ns([&]() { EVP_Digest(message.data(), message.size(), digest.data(), nullptr, md, nullptr); });
+    }
+
+    // Conversions of the input and output of the raw RSA operation.
+    BIGNUM* bn = BN_new();
+    res.phases["convert"] = time_ns([&]() {
+        BN_bin2bn(padded.data(), k, bn);
+        BN_bn2binpad(bn, out.data(), k);
+    });
+    BN_free(bn);
+
+    // Raw operations, without padding, on valid encoded inputs.
+    const auto raw_op = [&](bool priv, const uint8_t* in, uint8_t* result) {
+        const int len = priv ? RSA_private_encrypt(k, in, result, rsa, RSA_NO_PADDING) : RSA_public_encrypt(k, in, result, rsa, RSA_NO_PADDING);
+        if (len != k) {
+            fatal("raw RSA operation error");
+        }
+    };
+
+    switch (type) {
+        case OAEP_ENCRYPT:
+            res.phases["rng"] = time_ns([&]() { RAND_bytes(random.data(), SHA_DIGEST_LENGTH); });
+            res.phases["encode"] = time_ns([&]() {
+                RSA_padding_add_PKCS1_OAEP_mgf1(padded.data(), k, plain.data(), int(plain.size()), nullptr, 0, sha1, sha1);
+            });
+            res.phases["modexp"] = time_ns([&]() { raw_op(false, padded.data(), raw.data()); });
+            break;
+        case OAEP_DECRYPT:
+            RSA_padding_add_PKCS1_OAEP_mgf1(padded.data(), k, plain.data(), int(plain.size()), nullptr, 0, sha1, sha1);
+            raw_op(false, padded.data(), raw.data());
+            res.phases["modexp"] = time_ns([&]() { raw_op(true, raw.data(), padded.data()); });
+            res.phases["encode"] = time_ns([&]() {
+                RSA_padding_check_PKCS1_OAEP_mgf1(out.data(), k, padded.data(), k, k, nullptr, 0, sha1, sha1);
+            });
+            break;
+        case PSS_SIGN:
+            res.phases["rng"] = time_ns([&]() { RAND_bytes(random.data(), int(hlen)); });
+            res.phases["encode"] = time_ns([&]() {
+                RSA_padding_add_PKCS1_PSS_mgf1(rsa, padded.data(), digest.data(), md, md, RSA_PSS_SALTLEN_DIGEST);
+            });
+            res.phases["modexp"] = time_ns([&]() { raw_op(true, padded.data(), raw.data()); });
+            break;
+        case PSS_VERIFY:
+            RSA_padding_add_PKCS1_PSS_mgf1(rsa, padded.data(), digest.data(), md, md, RSA_PSS_SALTLEN_DIGEST);
+            raw_op(true, padded.data(), raw.data());
+            res.phases["modexp"] = time_ns([&]() { raw_op(false, raw.data(), padded.data()); });
+            res.phases["encode"] = time_ns([&]() {
+                RSA_verify_PKCS1_PSS_mgf1(rsa, digest.data(), md, md, padded.data(), RSA_PSS_SALTLEN_DIGEST);
+            });
+            break;
+    }
+
+    // The padding functions include the random draws, the raw RSA includes the conversions.
+    res.phases["encode"] = std::max(0.0, res.phases["encode"] - res.phase("rng"));
+    res.phases["modexp"] = std::max(0.0, res.phases["modexp"] - res.phases["convert"]);
+
+    // Complete operation again, after the phases, to estimate the noise on the total.
+    const double total2 = time_ns([&]() { op->run(); });
+    res.total = (total1 + total2) / 2 + res.phase("hash");
+    res.noise = std::abs(total1 - total2) / ((total1 + total2) / 2);
+
+    // The residual is signed, it is not significant when smaller than the noise.
+    double sum = 0.0;
+    for (const auto& it : res.phases) {
+        sum += it.second;
+    }
+    res.phases["other"] = res.total - sum;
+
+    EVP_MD_free(sha1);
+    EVP_MD_free(md);
+    return res;
+}
+
+
+//----------------------------------------------------------------------------
+// Run the phase breakdown of all tests.
+//----------------------------------------------------------------------------
+
+void phase_tests()
+{
+    std::vector<PhaseTimes> results;
+    for (const auto& key : opt.keys) {
+        const RSAKeys keys("rsa-" + key);
+        std::cout << "algo: " << keys.algo() << std::endl;
+        for (size_t i = 0; i < RSA_OP_COUNT; i++) {
+            const RSAOpType type = RSAOpType(i);
+            if (opt.ops.empty() || std::find(opt.ops.begin(), opt.ops.end(), op_name(type)) != opt.ops.end()) {
+                results.push_back(time_phases(keys, type, EVP_sha256()));
+                const PhaseTimes& res(results.back());
+                std::cout << op_name(type) << "-phase-total-ns: " << int64_t(res.total) << std::endl;
+                std::cout << op_name(type) << "-phase-total-noise-percent: " << (100.0 * res.noise) << std::endl;
+                for (const auto& name : PHASES) {
+                    const double ns = res.phase(name);
+                    std::cout << op_name(type) << "-phase-" << name << "-ns: " << int64_t(ns) << std::endl;
+                    std::cout << op_name(type) << "-phase-" << name << "-percent: " << (100.0 * ns / res.total) << std::endl;
+                }
+            }
+        }
+    }
+
+    std::cout << std::endl << "PHASES (PERCENT OF OPERATION TIME)" << std::endl << std::endl;
+    std::vector<std::vector<std::string>> lines;
+    lines.push_back({"test", "total (us)", "noise"});
+    lines.back().insert(lines.back().end(), PHASES.begin(), PHASES.end());
+    for (const auto& res : results) {
+        char cell[64];
+        std::snprintf(cell, sizeof(cell), "%.1f", res.total / 1000.0);
+        lines.push_back({res.test, cell});
+        std::snprintf(cell, sizeof(cell), "%.1f%%", 100.0 * res.noise);
+        lines.back().push_back(cell);
+        for (const auto& name : PHASES) {
+            if (res.phases.count(name) == 0) {
+                lines.back().push_back("-");
+            }
+            else {
+                std::snprintf(cell, sizeof(cell), "%.1f%%", 100.0 * res.phases.at(name) / res.total);
+                lines.back().push_back(cell);
+            }
+        }
+    }
+    print_table(lines);
+}
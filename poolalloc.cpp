@@ -0,0 +1,277 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Size-class thread-local pool allocator, for OpenSSL.
+//
+// OpenSSL 3 allocates and frees a few dozens of small blocks in each RSA
+// operation, mostly for bignums. Here, small blocks are rounded up to a
+// size class. Each thread keeps a free list per size class and reuses its
+// freed blocks without any lock. When a free list is empty, a batch of
+// blocks is taken from a global depot, which is refilled from large
+// chunks. When a free list becomes too long, half of it is returned to the
+// depot. Large blocks are directly allocated by the system allocator.
+//
+// Each block is prefixed with a 16-byte header containing its size class.
+// A block can be freed by any thread. The chunks are never released.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <mutex>
+#include <cstring>
+
+namespace {
+    // Size classes, in bytes of user data. Must be multiples of 16.
+    constexpr size_t CLASS_SIZES[] = {16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096};
+    constexpr size_t CLASS_COUNT = sizeof(CLASS_SIZES) / sizeof(CLASS_SIZES[0]);
+    constexpr size_t MAX_CLASS_SIZE = CLASS_SIZES[CLASS_COUNT - 1];
+    constexpr uint32_t LARGE_CLASS = 0xFFFFFFFF;
+
+    constexpr size_t HEADER_SIZE = 16;      // keep the alignment of malloc()
+    constexpr size_t BATCH_SIZE = 32;       // blocks moved between thread cache and depot
+    constexpr size_t MAX_CACHED = 256;      // max blocks in a thread free list
+    constexpr size_t CHUNK_SIZE = 65536;    // min size of chunks from the system
+
+    // Free block, the link uses the user data area.
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    // Global depot of free blocks for one size class.
+    struct Depot
+    {
+        std::mutex mutex {};
+        FreeBlock* head = nullptr;
+        size_t     count = 0;
+    };
+    Depot depots[CLASS_COUNT];
+
+    // Thread cache. Trivially destructible, remains usable after the flusher is destroyed.
+    struct ThreadCache
+    {
+        FreeBlock* heads[CLASS_COUNT];
+        size_t     counts[CLASS_COUNT];
+        bool       active;  // flusher registered
+        bool       dead;    // flusher executed, thread terminating
+    };
+    thread_local ThreadCache tcache;
+
+    // Return all cached blocks to the depot when the thread terminates.
+    struct CacheFlusher
+    {
+        void touch() {}
+        ~CacheFlusher();
+    };
+    thread_local CacheFlusher flusher;
+
+    // Lookup table from (size + 15) / 16 to size class, for sizes up to MAX_CLASS_SIZE.
+    struct ClassTable
+    {
+        uint8_t index[MAX_CLASS_SIZE / 16 + 1];
+        ClassTable()
+        {
+            size_t cls = 0;
+            for (size_t i = 0; i <= MAX_CLASS_SIZE / 16; i++) {
+                while (CLASS_SIZES[cls] < i * 16) {
+                    cls++;
+                }
+                index[i] = uint8_t(cls);
+            }
+        }
+    };
+    const ClassTable class_table;
+}
+
+
+//----------------------------------------------------------------------------
+// Block header access.
+//----------------------------------------------------------------------------
+
+static inline uint32_t& block_class(void* ptr)
+{
+    return *reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(ptr) - HEADER_SIZE);
+}
+
+
+//----------------------------------------------------------------------------
+// Depot operations, with lock.
+//----------------------------------------------------------------------------
+
+// Get a list of up to BATCH_SIZE blocks, allocate a new chunk if necessary.
+static FreeBlock* depot_get(size_t cls, size_t& count)
+{
+    Depot& depot(depots[cls]);
+    std::lock_guard<std::mutex> lock(depot.mutex);
+
+    if (depot.head == nullptr) {
+        // Carve a new chunk into blocks.
+        const size_t block_size = HEADER_SIZE + CLASS_SIZES[cls];
+        const size_t blocks = std::max(BATCH_SIZE, CHUNK_SIZE / block_size);
+        uint8_t* chunk = reinterpret_cast<uint8_t*>(std::malloc(blocks * block_size));
+        if (chunk == nullptr) {
+            count = 0;
+            return nullptr;
+        }
+        for (size_t i = 0; i < blocks; i++) {
+            uint8_t* ptr = chunk + i * block_size + HEADER_SIZE;
+            block_class(ptr) = uint32_t(cls);
+            FreeBlock* fb = reinterpret_cast<FreeBlock*>(ptr);
+            fb->next = depot.head;
+            depot.head = fb;
+        }
+        depot.count += blocks;
+    }
+
+    FreeBlock* head = depot.head;
+    FreeBlock* last = head;
+    count = 1;
+    while (count < BATCH_SIZE && last->next != nullptr) {
+        last = last->next;
+        count++;
+    }
+    depot.head = last->next;
+    depot.count -= count;
+    last->next = nullptr;
+    return head;
+}
+
+// Return a list of blocks to the depot.
+static void depot_put(size_t cls, FreeBlock* head, FreeBlock* last, size_t count)
+{
+    Depot& depot(depots[cls]);
+    std::lock_guard<std::mutex> lock(depot.mutex);
+    last->next = depot.head;
+    depot.head = head;
+    depot.count += count;
+}
+
+CacheFlusher::~CacheFlusher()
+{
+    for (size_t cls = 0; cls < CLASS_COUNT; cls++) {
+        FreeBlock* head = tcache.heads[cls];
+        if (head != nullptr) {
+            FreeBlock* last = head;
+            while (last->next != nullptr) {
+                last = last->next;
+            }
+            depot_put(cls, head, last, tcache.counts[cls]);
+            tcache.heads[cls] = nullptr;
+            tcache.counts[cls] = 0;
+        }
+    }
+    tcache.dead = true;
+}
+
+
+//----------------------------------------------------------------------------
+// Allocate a block.
+//----------------------------------------------------------------------------
+
+void* pool_malloc(size_t size)
+{
+    if (size > MAX_CLASS_SIZE) {
+        uint8_t* base = reinterpret_cast<uint8_t*>(std::malloc(size + HEADER_SIZE));
+        if (base == nullptr) {
+            return nullptr;
+        }
+        block_class(base + HEADER_SIZE) = LARGE_CLASS;
+        return base + HEADER_SIZE;
+    }
+
+    const size_t cls = class_table.index[(size + 15) / 16];
+
+    // After thread termination, go directly to the depot.
+    if (tcache.dead) {
+        size_t count = 0;
+        FreeBlock* head = depot_get(cls, count);
+        if (head != nullptr && head->next != nullptr) {
+            FreeBlock* last = head->next;
+            while (last->next != nullptr) {
+                last = last->next;
+            }
+            depot_put(cls, head->next, last, count - 1);
+        }
+        return head;
+    }
+
+    FreeBlock* fb = tcache.heads[cls];
+    if (fb == nullptr) {
+        if (!tcache.active) {
+            flusher.touch();
+            tcache.active = true;
+        }
+        fb = depot_get(cls, tcache.counts[cls]);
+        if (fb == nullptr) {
+            return nullptr;
+        }
+    }
+    tcache.heads[cls] = fb->next;
+    tcache.counts[cls]--;
+    return fb;
+}
+
+
+//----------------------------------------------------------------------------
+// Free a block.
+//----------------------------------------------------------------------------
+
+void pool_free(void* ptr)
+{
+    if (ptr == nullptr) {
+        return;
+    }
+    const uint32_t cls = block_class(ptr);
+    if (cls == LARGE_CLASS) {
+        std::free(reinterpret_cast<uint8_t*>(ptr) - HEADER_SIZE);
+        return;
+    }
+
+    FreeBlock* fb = reinterpret_cast<FreeBlock*>(ptr);
+    if (tcache.dead) {
+        depot_put(cls, fb, fb, 1);
+        return;
+    }
+
+    fb->next = tcache.heads[cls];
+    tcache.heads[cls] = fb;
+    if (++tcache.counts[cls] > MAX_CACHED) {
+        // Return the first half of the free list to the depot.
+        FreeBlock* last = fb;
+        for (size_t i = 1; i < MAX_CACHED / 2; i++) {
+            last = last->next;
+        }
+        tcache.heads[cls] = last->next;
+        tcache.counts[cls] -= MAX_CACHED / 2;
+        depot_put(cls, fb, last, MAX_CACHED / 2);
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Reallocate a block.
+//----------------------------------------------------------------------------
+
+void* pool_realloc(void* ptr, size_t size)
+{
+    if (ptr == nullptr) {
+        return pool_malloc(size);
+    }
+    const uint32_t cls = block_class(ptr);
+    if (cls == LARGE_CLASS && size > MAX_CLASS_SIZE) {
+        uint8_t* base = reinterpret_cast<uint8_t*>(std::realloc(reinterpret_cast<uint8_t*>(ptr) - HEADER_SIZE, size + HEADER_SIZE));
+        return base == nullptr ? nullptr : base + HEADER_SIZE;
+    }
+    if (cls != LARGE_CLASS && size <= CLASS_SIZES[cls]) {
+        return ptr;
+    }
+    void* new_ptr = pool_malloc(size);
+    if (new_ptr != nullptr) {
+        // A large block is larger than any new size class.
+        std::memcpy(new_ptr, ptr, cls == LARGE_CLASS ? size : std::min(size, CLASS_SIZES[cls]));
+        pool_free(ptr);
+    }
+    return new_ptr;
+}
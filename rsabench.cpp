@@ -3,26 +3,24 @@
 // BSD 2-Clause License, see LICENSE file.
 //----------------------------------------------------------------------------
 
-#include <iostream>
-#include <vector>
+#include "rsabench.h"
 #include <filesystem>
-#include <cstdlib>
-#include <cinttypes>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstring>
 #include <unistd.h>
 #include <sys/resource.h>
 
-#include <openssl/opensslv.h>
-#include <openssl/evp.h>
-#include <openssl/pem.h>
-#include <openssl/err.h>
-
 #if defined(__APPLE__)
     #include <libproc.h>
 #endif
 
-constexpr int64_t USECPERSEC = 1000000;  // microseconds per second
-constexpr int64_t MIN_CPU_TIME = 2 * USECPERSEC;
-constexpr size_t  INNER_LOOP_COUNT = 10;
+Options opt;
 
 
 //----------------------------------------------------------------------------
@@ -41,6 +39,27 @@ int64_t cpu_time()
 }
 
 
+//----------------------------------------------------------------------------
+// Get current monotonic wall-clock time in nanoseconds.
+//----------------------------------------------------------------------------
+
+int64_t wall_time_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+//----------------------------------------------------------------------------
+// Get the number of CPU's which are available to this process.
+//----------------------------------------------------------------------------
+
+size_t cpu_count()
+{
+    const size_t count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+
 //----------------------------------------------------------------------------
 // OpenSSL error, abort application.
 //----------------------------------------------------------------------------
@@ -126,214 +145,573 @@ void print_result(const char* name, uint64_t count, uint64_t size, uint64_t dura
 
 
 //----------------------------------------------------------------------------
-// Perform one test
+// Run a function in a closed loop during the test duration and print the
+// result. The function is called once before, to warm up and check errors.
 //----------------------------------------------------------------------------
 
-void one_test(const char* private_key_file, const char* public_key_file, const EVP_MD* evp_pss_hash)
+void timed_loop(const char* name, uint64_t size, const std::function<void()>& func)
 {
-    const std::string dir(keys_directory() + "/");
-    const std::string kpriv_file(dir + private_key_file);
-    const std::string kpub_file(dir + public_key_file);
+    func();
+    uint64_t count = 0;
+    uint64_t duration = 0;
+    const int64_t start = cpu_time();
+    do {
+        for (size_t i = 0; i < INNER_LOOP_COUNT; i++) {
+            func();
+        }
+        count += INNER_LOOP_COUNT;
+        duration = cpu_time() - start;
+    } while (duration < uint64_t(opt.loop_time));
+    print_result(name, count, count * size, duration);
+}
 
-    // Load keys.
-    std::FILE* fp = nullptr;
-    if ((fp = std::fopen(kpriv_file.c_str(), "r")) == nullptr) {
-        perror(kpriv_file.c_str());
-        std::exit(EXIT_FAILURE);
-    }
-    EVP_PKEY* kpriv = PEM_read_PrivateKey(fp, nullptr, nullptr, nullptr);
-    if (kpriv == nullptr) {
-        fatal("error loading private key from " + kpriv_file);
+
+//----------------------------------------------------------------------------
+// Run functions in several threads, until the test time has elapsed in
+// wall-clock time. The factory is called in each thread, with the thread
+// index, to create its loop. All threads start at the same time, once they
+// are all initialized. Return the total number of calls.
+//----------------------------------------------------------------------------
+
+namespace {
+    struct LoopThread
+    {
+        std::function<void()> run {};           // function to call in the loop
+        std::function<void(int64_t)> begin {};  // optional, called at start time (in nanoseconds)
+        std::function<void()> end {};           // optional, called at end of loop
+    };
+}
+
+static uint64_t run_threads(size_t threads_count, const std::function<LoopThread(size_t)>& factory, int64_t& start, uint64_t& duration)
+{
+    std::atomic<size_t> ready(0);
+    std::atomic<bool> go(false);
+    std::atomic<bool> stop(false);
+    std::atomic<int64_t> go_time(0);
+    std::vector<uint64_t> counts(threads_count, 0);
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < threads_count; t++) {
+        threads.emplace_back([&, t]() {
+            const LoopThread loop(factory(t));
+            ready++;
+            while (!go) {
+                std::this_thread::yield();
+            }
+            if (loop.begin) {
+                loop.begin(go_time);
+            }
+            while (!stop) {
+                for (size_t i = 0; i < INNER_LOOP_COUNT; i++) {
+                    loop.run();
+                }
+                counts[t] += INNER_LOOP_COUNT;
+            }
+            if (loop.end) {
+                loop.end();
+            }
+        });
     }
-    fclose(fp);
 
-    if ((fp = std::fopen(kpub_file.c_str(), "r")) == nullptr) {
-        perror(kpub_file.c_str());
-        std::exit(EXIT_FAILURE);
+    while (ready < threads_count) {
+        std::this_thread::yield();
     }
-    EVP_PKEY* kpub = PEM_read_PUBKEY(fp, nullptr, nullptr, nullptr);
-    if (kpub == nullptr) {
-        fatal("error loading public key from " + kpub_file);
+    go_time = start = wall_time_ns();
+    go = true;
+    std::this_thread::sleep_for(std::chrono::microseconds(opt.loop_time));
+    stop = true;
+    for (auto& th : threads) {
+        th.join();
     }
-    fclose(fp);
+    duration = (wall_time_ns() - start) / 1000;
+    return std::accumulate(counts.begin(), counts.end(), uint64_t(0));
+}
 
-    // Check key size consistency.
-    if (EVP_PKEY_get_bits(kpriv) != EVP_PKEY_get_bits(kpub) || EVP_PKEY_get_size(kpriv) != EVP_PKEY_get_size(kpub)) {
-        fatal("internal error: inconsistent key sizes");
+
+//----------------------------------------------------------------------------
+// Same as timed_loop() in several threads, in wall-clock time. The factory
+// is called once per thread to create the function which runs in it.
+//----------------------------------------------------------------------------
+
+void parallel_loop(const char* name, uint64_t size, size_t threads_count, const std::function<std::function<void()>()>& factory)
+{
+    if (threads_count <= 1) {
+        timed_loop(name, size, factory());
+        return;
     }
 
-    // Use input data of half the max output size for the algorithm.
-    // This is the usual scheme: RSA-2048 -> 256 bytes -> sign/encrypt 128-bit data.
-    const size_t key_bits = EVP_PKEY_get_bits(kpriv);
-    const size_t data_size = EVP_PKEY_get_size(kpriv);
-    std::vector<uint8_t> input(data_size / 2, 0xA5);
+    int64_t start = 0;
+    uint64_t duration = 0;
+    const uint64_t count = run_threads(threads_count, [&](size_t) {
+        LoopThread loop;
+        loop.run = factory();
+        loop.run();
+        return loop;
+    }, start, duration);
+    print_result(name, count, count * size, duration);
+}
+
 
-    std::cout << "algo: " << EVP_PKEY_get0_type_name(kpriv) << "-" << key_bits << std::endl;
-    std::cout << "key-size: " << key_bits << std::endl;
-    std::cout << "data-size: " << input.size() << std::endl;
-    std::cout << "output-size: " << data_size << std::endl;
+//----------------------------------------------------------------------------
+// Latency statistics, in microseconds, from a list of latencies in nanoseconds.
+//----------------------------------------------------------------------------
 
-    // Initialize encryption with OAEP padding.
-    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(kpub, nullptr);
-    if (ctx == nullptr) {
-        fatal("error in EVP_PKEY_CTX_new(public-key)");
+LatencyStats::LatencyStats(std::vector<int64_t>& latencies) :
+    count(latencies.size())
+{
+    if (count > 0) {
+        std::sort(latencies.begin(), latencies.end());
+        const auto percentile = [&latencies](double p) {
+            const size_t index = std::max<size_t>(size_t(std::ceil(p * latencies.size())), 1) - 1;
+            return double(latencies[std::min(index, latencies.size() - 1)]) / 1000.0;
+        };
+        mean = double(std::accumulate(latencies.begin(), latencies.end(), int64_t(0))) / (1000.0 * count);
+        p50 = percentile(0.50);
+        p90 = percentile(0.90);
+        p99 = percentile(0.99);
+        p999 = percentile(0.999);
+        max = double(latencies.back()) / 1000.0;
     }
-    if (EVP_PKEY_encrypt_init(ctx) <= 0) {
-        fatal("error in EVP_PKEY_encrypt_init");
+}
+
+
+//----------------------------------------------------------------------------
+// Run an operation in several threads, until the test time has elapsed
+// in wall-clock time. The first thread uses the provided operation object.
+//----------------------------------------------------------------------------
+
+void threaded_loop(const RSAKeys& keys, BackendOperation& op, const EVP_MD* evp_pss_hash, uint64_t& count, uint64_t& size, uint64_t& duration, PerfValues& perf, TimeSeries& series)
+{
+    std::vector<PerfValues> perfs(opt.threads);
+    std::vector<TimeSeries> series_list(opt.threads, series);
+    int64_t start = 0;
+
+    count = run_threads(opt.threads, [&](size_t t) {
+        const std::shared_ptr<BackendOperation> local(t == 0 ? nullptr : current_backend().new_operation(keys, op.type(), evp_pss_hash));
+        BackendOperation* const top = t == 0 ? &op : local.get();
+        const std::shared_ptr<PerfCounters> counters(new PerfCounters(!opt.perf));
+        TimeSeries& ts(series_list[t]);
+        LoopThread loop;
+        if (opt.series_interval > 0) {
+            loop.run = [local, top, &ts]() {
+                top->run();
+                ts.add(wall_time_ns(), 1);
+            };
+        }
+        else {
+            loop.run = [local, top]() { top->run(); };
+        }
+        loop.begin = [counters, &ts](int64_t go_time) {
+            counters->start();
+            ts.start = go_time;
+        };
+        loop.end = [counters, &perfs, t]() { perfs[t] = counters->stop(); };
+        return loop;
+    }, start, duration);
+
+    size = count * op.data_size();
+    for (const auto& values : perfs) {
+        add_perf_values(perf, values);
     }
-    if (EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) <= 0) {
-        fatal("error in EVP_PKEY_CTX_set_rsa_padding(RSA_PKCS1_OAEP_PADDING)");
+    series.start = start;
+    for (const auto& ts : series_list) {
+        series.merge(ts);
     }
+}
+
+
+//----------------------------------------------------------------------------
+// Perform one test loop on an operation.
+//----------------------------------------------------------------------------
 
-    // Encryption test.
-    std::vector<uint8_t> encrypted(data_size);
-    size_t encrypted_len = 0;
+void one_loop(const RSAKeys& keys, RSAOpType type, const EVP_MD* evp_pss_hash)
+{
+    const std::unique_ptr<BackendOperation> op_ptr(current_backend().new_operation(keys, type, evp_pss_hash));
+    BackendOperation& op(*op_ptr);
     uint64_t count = 0;
     uint64_t size = 0;
     uint64_t duration = 0;
-    uint64_t start = cpu_time();
+    MemStats mem_start;
+    if (opt.mem_stats) {
+        mem_reset_peak();
+        mem_start = mem_stats();
+    }
 
-    do {
-        for (size_t i = 0; i < INNER_LOOP_COUNT; i++) {
-            encrypted_len = encrypted.size();
-            if (EVP_PKEY_encrypt(ctx, encrypted.data(), &encrypted_len, input.data(), input.size()) <= 0) {
-                fatal("RSA encrypt error");
-            }
-            size += input.size();
-            count++;
-        }
-        duration = cpu_time() - start;
-    } while (duration < MIN_CPU_TIME);
+    PerfValues perf;
+    TimeSeries series(wall_time_ns(), opt.series_interval * 1000);
+    const EnergySample energy_start(opt.energy ? energy_sample() : EnergySample());
 
-    // End of encryption test.
-    std::cout << "encrypted-size: " << encrypted_len << std::endl;
-    print_result("oaep-encrypt", count, size, duration);
-    EVP_PKEY_CTX_free(ctx);
+    if (opt.threads > 1) {
+        threaded_loop(keys, op, evp_pss_hash, count, size, duration, perf, series);
+    }
+    else {
+        PerfCounters counters(!opt.perf);
+        counters.start();
+        series.start = wall_time_ns();
+        uint64_t start = cpu_time();
+        do {
+            for (size_t i = 0; i < INNER_LOOP_COUNT; i++) {
+                op.run();
+                size += op.data_size();
+                count++;
+                if (opt.series_interval > 0) {
+                    series.add(wall_time_ns(), 1);
+                }
+            }
+            duration = cpu_time() - start;
+        } while (duration < uint64_t(opt.loop_time));
+        perf = counters.stop();
+    }
 
-    // Initialize decryption with OAEP padding.
-    if ((ctx = EVP_PKEY_CTX_new(kpriv, nullptr)) == nullptr) {
-        fatal("error in EVP_PKEY_CTX_new(private-key)");
+    const MemStats mem_end(opt.mem_stats ? mem_stats() : MemStats());
+    const EnergySample energy_end(opt.energy ? energy_sample() : EnergySample());
+    op.print_info();
+    print_result(op.name(), count, size, duration);
+    const double mhz = effective_mhz(perf);
+    const double post_mhz = mhz > 0.0 ? 0.0 : post_test_mhz();
+    if (mhz > 0.0) {
+        std::cout << op.name() << "-effective-mhz: " << int64_t(mhz + 0.5) << std::endl;
     }
-    if (EVP_PKEY_decrypt_init(ctx) <= 0) {
-        fatal("error in EVP_PKEY_decrypt_init");
+    else if (post_mhz > 0.0) {
+        std::cout << op.name() << "-post-test-mhz: " << int64_t(post_mhz + 0.5) << std::endl;
     }
-    if (EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) <= 0) {
-        fatal("error in EVP_PKEY_CTX_set_rsa_padding(RSA_PKCS1_OAEP_PADDING)");
+    if (current_backend().name() == "openssl") {
+        std::cout << op.name() << "-code-path: " << openssl_code_path(keys, type) << std::endl;
     }
+    if (opt.mem_stats) {
+        print_mem_stats(op.name(), count, mem_start, mem_end);
+    }
+    if (opt.perf) {
+        print_perf_values(op.name(), count, perf);
+    }
+    if (opt.energy) {
+        print_energy(op.name(), count, energy_start, energy_end);
+    }
+    if (opt.series_interval > 0) {
+        print_time_series(op.name(), series);
+    }
+    op.check();
+}
 
-    // Decryption test.
-    std::vector<uint8_t> decrypted(data_size);
-    size_t decrypted_len = 0;
-    count = 0;
-    size = 0;
-    duration = 0;
-    start = cpu_time();
 
-    do {
-        for (size_t i = 0; i < INNER_LOOP_COUNT; i++) {
-            decrypted_len = decrypted.size();
-            if (EVP_PKEY_decrypt(ctx, decrypted.data(), &decrypted_len, encrypted.data(), encrypted_len) <= 0) {
-                fatal("RSA decrypt error");
-            }
-            size += encrypted_len;
-            count++;
-        }
-        duration = cpu_time() - start;
-    } while (duration < MIN_CPU_TIME);
+//----------------------------------------------------------------------------
+// Perform one test
+//----------------------------------------------------------------------------
 
-    // End of decryption test.
-    std::cout << "decrypted-size: " << decrypted_len << std::endl;
-    print_result("oaep-decrypt", count, size, duration);
-    EVP_PKEY_CTX_free(ctx);
+void one_test(const std::string& key_name, const EVP_MD* evp_pss_hash)
+{
+    const RSAKeys keys("rsa-" + key_name);
+    const size_t data_size = keys.size();
 
-    // Check decrypted data.
-    if (decrypted_len != input.size() || memcmp(input.data(), decrypted.data(), decrypted_len) != 0) {
-        fatal("decrypted data don't match input");
-    }
+    std::cout << "algo: " << keys.algo() << std::endl;
+    std::cout << "key-size: " << keys.bits() << std::endl;
+    std::cout << "public-exponent: " << keys.exponent() << std::endl;
+    std::cout << "data-size: " << (data_size / 2) << std::endl;
+    std::cout << "output-size: " << data_size << std::endl;
 
-    // Initialize signature with PSS padding.
-    if ((ctx = EVP_PKEY_CTX_new(kpriv, nullptr)) == nullptr) {
-        fatal("error in EVP_PKEY_CTX_new(private-key)");
-    }
-    if (EVP_PKEY_sign_init(ctx) <= 0) {
-        fatal("error in EVP_PKEY_sign_init");
-    }
-    if (EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PSS_PADDING) <= 0) {
-        fatal("error in EVP_PKEY_CTX_set_rsa_padding");
+    for (size_t i = 0; i < RSA_OP_COUNT; i++) {
+        const RSAOpType type = RSAOpType(i);
+        if (opt.ops.empty() || std::find(opt.ops.begin(), opt.ops.end(), op_name(type)) != opt.ops.end()) {
+            one_loop(keys, type, evp_pss_hash);
+        }
     }
-    if (EVP_PKEY_CTX_set_signature_md(ctx, evp_pss_hash) <= 0) {
-        fatal("error in EVP_PKEY_CTX_set_signature_md");
+}
+
+
+//----------------------------------------------------------------------------
+// Command line parsing.
+//----------------------------------------------------------------------------
+
+[[noreturn]] void usage()
+{
+    std::string backends;
+    for (const auto& name : backend_names()) {
+        backends += (backends.empty() ? "" : ", ") + name;
     }
+    std::cerr << std::endl
+              << "Syntax: rsabench [options]" << std::endl
+              << std::endl
+              << "Without option, run all closed-loop throughput tests." << std::endl
+              << std::endl
+              << "Options:" << std::endl
+              << "  --keys list      comma-separated list of key sizes (default: 2048,3072,4096)" << std::endl
+              << "  --ops list       comma-separated list of operations (encrypt, decrypt, sign, verify)" << std::endl
+              << "  --exponents list comma-separated list of public exponents (3, 17, 65537, big), for each key size," << std::endl
+              << "                   default operations: encrypt, verify" << std::endl
+              << "  --threads n      run each test in n threads, report the aggregated throughput (default: 1)" << std::endl
+              << "  --mem-stats      report OpenSSL memory allocations per operation in each test" << std::endl
+              << "  --pool-alloc     use a thread-local pool allocator in OpenSSL" << std::endl
+              << "  --perf           report hardware performance counters (IPC, misses, top-down) in each test" << std::endl
+              << "  --energy         report the RAPL energy consumption per operation in each test" << std::endl
+              << "  --series ms      report the throughput in each interval of ms milliseconds in each test" << std::endl
+              << "  --soak sec       run each test during sec seconds (default: 2), implies --series 100" << std::endl
+              << "  --backend list   comma-separated list of crypto backends, \"all\" for all available ones" << std::endl
+              << "                   (" << backends << "), compared in child processes" << std::endl
+              << std::endl
+              << "Allocator comparison:" << std::endl
+              << "  --alloc-matrix       run the tests with each malloc library which is found on the system" << std::endl
+              << "  --threads-list list  comma-separated list of thread counts (default: 1 and number of CPU's)" << std::endl
+              << std::endl
+              << "Instruction set extensions:" << std::endl
+              << "  --isa-sweep      run the tests with each CPU extension masked off in OpenSSL" << std::endl
+              << "  --ifma-ab        run the tests with and without the AVX-512 IFMA code in OpenSSL" << std::endl
+              << "  --phases         time each phase of the operations: hash, rng, encode, convert, modexp" << std::endl
+              << std::endl
+              << "Protocols:" << std::endl
+              << "  --tls            full TLS 1.2 and 1.3 handshakes over memory BIO's, RSA and ECDHE-RSA" << std::endl
+              << "  --x509           X.509 chain verification (root, intermediate, leaf), cold and cached" << std::endl
+              << "  --cms            CMS signing with RSA-PSS and enveloping with RSA-OAEP of documents" << std::endl
+              << "  --doc-size n     CMS: size of documents in bytes (default: 4096)" << std::endl
+              << "  --recipients n   CMS: envelope to 1 to n recipients (default: 3)" << std::endl
+              << "  --jwt            JWT RS256, PS256, PS512, single-threaded and with --threads (default: all CPU's)" << std::endl
+              << std::endl
+              << "Open-loop latency tests:" << std::endl
+              << "  --open-loop      issue requests at a target arrival rate, report latency vs. load" << std::endl
+              << "  --poisson        Poisson arrivals (default: constant rate)" << std::endl
+              << "  --rates list     comma-separated list of offered loads in op/s (default: from capacity)" << std::endl
+              << "  --workers n      number of worker threads (default: number of CPU's)" << std::endl
+              << "  --duration sec   duration of each load point (default: 2)" << std::endl
+              << "  --slo usec       SLO on p99 latency, report the max load which meets it" << std::endl
+              << "  --mix spec       mixed workload, random operations with weights, e.g. verify=70,sign/4096=20" << std::endl
+              << "                   (format: op[/key]=weight,..., without key: spread over --keys)" << std::endl
+              << std::endl
+              << "Signing daemon over a Unix socket:" << std::endl
+              << "  --server path    serve RSA operations on the socket, using --workers threads" << std::endl
+              << "  --batch n        max number of requests in a micro-batch (default: 1)" << std::endl
+              << "                   on the client: number of outstanding requests per connection" << std::endl
+              << "  --batch-wait us  max time to wait for a full micro-batch (default: 0)" << std::endl
+              << "  --client path    generate load on the server during --duration per operation" << std::endl
+              << "  --connections n  number of concurrent client connections (default: 1)" << std::endl
+              << std::endl
+              << "RSA offload service over a shared memory ring:" << std::endl
+              << "  --shm-server name     serve RSA operations on the named shared memory, using --workers threads" << std::endl
+              << "  --shm-client name     generate load on the server, using --connections clients" << std::endl
+              << "  --inprocess-client    same load with direct in-process calls, as a reference" << std::endl
+              << std::endl;
+    std::exit(EXIT_FAILURE);
+}
 
-    const size_t digest_size = EVP_MD_get_size(evp_pss_hash);
-    std::cout << "pss-digest-size: " << (8 * digest_size) << std::endl;
+// Split a comma-separated list.
+std::vector<std::string> split_list(const std::string& list)
+{
+    std::vector<std::string> result;
+    size_t start = 0;
+    for (size_t sep = 0; (sep = list.find(',', start)) != std::string::npos; start = sep + 1) {
+        result.push_back(list.substr(start, sep - start));
+    }
+    result.push_back(list.substr(start));
+    return result;
+}
 
-    // Signature test.
-    std::vector<uint8_t> to_be_signed(digest_size, 0x5A);
-    std::vector<uint8_t> signature(1024);
-    size_t signature_len = 0;
-    count = 0;
-    size = 0;
-    duration = 0;
-    start = cpu_time();
+// Get a numerical value for an option.
+double number_value(const std::string& value)
+{
+    char* end = nullptr;
+    const double d = std::strtod(value.c_str(), &end);
+    if (value.empty() || *end != '\0' || d < 0.0) {
+        std::cerr << "rsabench: invalid numerical value '" << value << "'" << std::endl;
+        usage();
+    }
+    return d;
+}
 
-    do {
-        for (size_t i = 0; i < INNER_LOOP_COUNT; i++) {
-            signature_len = signature.size();
-            if (EVP_PKEY_sign(ctx, signature.data(), &signature_len, to_be_signed.data(), to_be_signed.size()) <= 0) {
-                fatal("RSA sign error");
+void parse_options(int argc, char* argv[])
+{
+    bool soak = false;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg(argv[i]);
+        const bool has_value = i + 1 < argc;
+        const int first = i;
+        bool for_child = true;
+        if (arg == "--keys" && has_value) {
+            opt.keys = split_list(argv[++i]);
+        }
+        else if (arg == "--exponents" && has_value) {
+            opt.exponents = split_list(argv[++i]);
+            for (const auto& e : opt.exponents) {
+                if (e != "3" && e != "17" && e != "65537" && e != "big") {
+                    std::cerr << "rsabench: invalid public exponent '" << e << "'" << std::endl;
+                    usage();
+                }
             }
-            size += input.size();
-            count++;
         }
-        duration = cpu_time() - start;
-    } while (duration < MIN_CPU_TIME);
-
-    // End of signature test.
-    std::cout << "signature-size: " << signature_len << std::endl;
-    print_result("pss-sign", count, size, duration);
-    EVP_PKEY_CTX_free(ctx);
-
-    // Initialize signature verification with PSS padding.
-    if ((ctx = EVP_PKEY_CTX_new(kpub, nullptr)) == nullptr) {
-        fatal("error in EVP_PKEY_CTX_new(public-key)");
+        else if (arg == "--ops" && has_value) {
+            opt.ops.clear();
+            for (const auto& name : split_list(argv[++i])) {
+                opt.ops.push_back(op_name(op_type(name)));
+            }
+        }
+        else if (arg == "--threads" && has_value) {
+            opt.threads = std::max<size_t>(1, size_t(number_value(argv[++i])));
+            for_child = false;
+        }
+        else if (arg == "--mem-stats") {
+            opt.mem_stats = true;
+        }
+        else if (arg == "--pool-alloc") {
+            opt.pool_alloc = true;
+        }
+        else if (arg == "--perf") {
+            opt.perf = true;
+        }
+        else if (arg == "--energy") {
+            opt.energy = true;
+        }
+        else if (arg == "--series" && has_value) {
+            opt.series_interval = int64_t(number_value(argv[++i]) * 1000);
+        }
+        else if (arg == "--soak" && has_value) {
+            opt.loop_time = std::max<int64_t>(1, int64_t(number_value(argv[++i]) * USECPERSEC));
+            soak = true;
+        }
+        else if (arg == "--open-loop") {
+            opt.open_loop = true;
+        }
+        else if (arg == "--poisson") {
+            opt.poisson = true;
+        }
+        else if (arg == "--mix" && has_value) {
+            // Format: op[/key]=weight,...
+            opt.mix.clear();
+            for (const auto& item : split_list(argv[++i])) {
+                const size_t equal = item.find('=');
+                const size_t slash = item.substr(0, equal).find('/');
+                MixEntry entry;
+                entry.op = op_name(op_type(item.substr(0, std::min(slash, equal))));
+                entry.key = slash == std::string::npos ? "" : item.substr(slash + 1, equal - slash - 1);
+                entry.weight = equal == std::string::npos ? 1.0 : number_value(item.substr(equal + 1));
+                opt.mix.push_back(entry);
+            }
+        }
+        else if (arg == "--rates" && has_value) {
+            opt.rates.clear();
+            for (const auto& rate : split_list(argv[++i])) {
+                opt.rates.push_back(number_value(rate));
+                if (opt.rates.back() <= 0.0) {
+                    std::cerr << "rsabench: invalid rate '" << rate << "', must be positive" << std::endl;
+                    usage();
+                }
+            }
+        }
+        else if (arg == "--workers" && has_value) {
+            opt.workers = size_t(number_value(argv[++i]));
+        }
+        else if (arg == "--duration" && has_value) {
+            opt.duration = int64_t(number_value(argv[++i]) * USECPERSEC);
+        }
+        else if (arg == "--slo" && has_value) {
+            opt.slo_p99 = number_value(argv[++i]);
+        }
+        else if (arg == "--server" && has_value) {
+            opt.server = argv[++i];
+        }
+        else if (arg == "--client" && has_value) {
+            opt.client = argv[++i];
+        }
+        else if (arg == "--batch" && has_value) {
+            opt.batch = std::max<size_t>(1, size_t(number_value(argv[++i])));
+        }
+        else if (arg == "--batch-wait" && has_value) {
+            opt.batch_wait = int64_t(number_value(argv[++i]));
+        }
+        else if (arg == "--connections" && has_value) {
+            opt.connections = std::max<size_t>(1, size_t(number_value(argv[++i])));
+        }
+        else if (arg == "--shm-server" && has_value) {
+            opt.shm_server = argv[++i];
+        }
+        else if (arg == "--shm-client" && has_value) {
+            opt.shm_client = argv[++i];
+        }
+        else if (arg == "--inprocess-client") {
+            opt.inprocess_client = true;
+        }
+        else if (arg == "--alloc-matrix") {
+            opt.alloc_matrix = true;
+            for_child = false;
+        }
+        else if (arg == "--isa-sweep") {
+            opt.isa_sweep = true;
+            for_child = false;
+        }
+        else if (arg == "--ifma-ab") {
+            opt.ifma_ab = true;
+            for_child = false;
+        }
+        else if (arg == "--phases") {
+            opt.phases = true;
+        }
+        else if (arg == "--tls") {
+            opt.tls = true;
+        }
+        else if (arg == "--x509") {
+            opt.x509 = true;
+        }
+        else if (arg == "--cms") {
+            opt.cms = true;
+        }
+        else if (arg == "--jwt") {
+            opt.jwt = true;
+        }
+        else if (arg == "--doc-size" && has_value) {
+            opt.doc_size = size_t(number_value(argv[++i]));
+        }
+        else if (arg == "--recipients" && has_value) {
+            opt.recipients = std::max<size_t>(1, size_t(number_value(argv[++i])));
+        }
+        else if (arg == "--backend" && has_value) {
+            opt.backends = split_list(argv[++i]);
+            if (opt.backends.size() == 1 && opt.backends.front() == "all") {
+                opt.backends = backend_names();
+            }
+            for (const auto& name : opt.backends) {
+                get_backend(name);  // check existence
+            }
+            for_child = false;
+        }
+        else if (arg == "--threads-list" && has_value) {
+            opt.threads_list.clear();
+            for (const auto& count : split_list(argv[++i])) {
+                opt.threads_list.push_back(std::max<size_t>(1, size_t(number_value(count))));
+            }
+            for_child = false;
+        }
+        else {
+            usage();
+        }
+        if (for_child) {
+            opt.child_args.insert(opt.child_args.end(), argv + first, argv + i + 1);
+        }
     }
-    if (EVP_PKEY_verify_init(ctx) <= 0) {
-        fatal("error in EVP_PKEY_verify_init");
+    if (opt.workers == 0) {
+        opt.workers = cpu_count();
     }
-    if (EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PSS_PADDING) <= 0) {
-        fatal("error in EVP_PKEY_CTX_set_rsa_padding");
+    if (soak && opt.series_interval == 0) {
+        opt.series_interval = DEFAULT_SERIES_INTERVAL;
     }
-    if (EVP_PKEY_CTX_set_signature_md(ctx, evp_pss_hash) <= 0) {
-        fatal("error in EVP_PKEY_CTX_set_signature_md");
+    if (!opt.mix.empty()) {
+        // Operations without key are evenly spread over all keys.
+        std::vector<MixEntry> mix;
+        for (const auto& entry : opt.mix) {
+            for (const auto& key : entry.key.empty() ? opt.keys : std::vector<std::string>{entry.key}) {
+                mix.push_back({entry.op, key, entry.key.empty() ? entry.weight / opt.keys.size() : entry.weight});
+            }
+        }
+        opt.mix = mix;
     }
-
-    // Signature verification test.
-    count = 0;
-    size = 0;
-    duration = 0;
-    start = cpu_time();
-
-    do {
-        for (size_t i = 0; i < INNER_LOOP_COUNT; i++) {
-            // Status: 1=verified, 0=not verified, <0 = error
-            const int res = EVP_PKEY_verify(ctx, signature.data(), signature_len, to_be_signed.data(), to_be_signed.size());
-            if (res <= 0) {
-                fatal("RSA verify error");
+    if (!opt.exponents.empty()) {
+        // One key pair per size and exponent, the exponent only changes the public key operations.
+        std::vector<std::string> keys;
+        for (const auto& size : opt.keys) {
+            for (const auto& e : opt.exponents) {
+                keys.push_back(e == "65537" ? size : size + "-e" + e);
             }
-            size += signature_len;
-            count++;
         }
-        duration = cpu_time() - start;
-    } while (duration < MIN_CPU_TIME);
-
-    // End of signature verification test.
-    print_result("pss-verify", count, size, duration);
-    EVP_PKEY_CTX_free(ctx);
-
-    // Free keys.
-    EVP_PKEY_free(kpub);
-    EVP_PKEY_free(kpriv);
+        opt.keys = keys;
+        if (opt.ops.empty()) {
+            opt.ops = {op_name(OAEP_ENCRYPT), op_name(PSS_VERIFY)};
+        }
+    }
 }
 
 
@@ -343,15 +721,83 @@ void one_test(const char* private_key_file, const char* public_key_file, const E
 
 int main(int argc, char* argv[])
 {
+    parse_options(argc, argv);
+
+    // Memory hooks must be installed before any allocation in OpenSSL.
+    if (opt.mem_stats || opt.pool_alloc) {
+        install_mem_hooks();
+    }
+
     // OpenSSL initialization.
     ERR_load_crypto_strings();
     OpenSSL_add_all_algorithms();
     print_openssl_version();
+    print_host_info();
+    if (opt.pool_alloc) {
+        std::cout << "allocator: pool" << std::endl;
+    }
+    if (opt.threads > 1) {
+        std::cout << "threads: " << opt.threads << std::endl;
+    }
+    if (opt.backends.size() == 1) {
+        std::cout << "backend: " << current_backend().name() << ", " << current_backend().version() << std::endl;
+    }
 
     // Run tests.
-    one_test("rsa-2048-prv.pem", "rsa-2048-pub.pem", EVP_sha256());
-    one_test("rsa-3072-prv.pem", "rsa-3072-pub.pem", EVP_sha256());  // or 384
-    one_test("rsa-4096-prv.pem", "rsa-4096-pub.pem", EVP_sha256());  // or 512
+    if (opt.alloc_matrix) {
+        alloc_matrix_tests();
+    }
+    else if (opt.isa_sweep) {
+        isa_sweep_tests();
+    }
+    else if (opt.ifma_ab) {
+        ifma_ab_tests();
+    }
+    else if (opt.phases) {
+        phase_tests();
+    }
+    else if (opt.tls) {
+        tls_tests();
+    }
+    else if (opt.x509) {
+        x509_tests();
+    }
+    else if (opt.cms) {
+        cms_tests();
+    }
+    else if (opt.jwt) {
+        jwt_tests();
+    }
+    else if (opt.backends.size() > 1) {
+        backend_tests();
+    }
+    else if (!opt.server.empty()) {
+        run_server();
+    }
+    else if (!opt.shm_server.empty()) {
+        run_shm_server();
+    }
+    else if (!opt.client.empty()) {
+        std::cout << "client-pipeline: " << opt.batch << std::endl;
+        run_client_tests("socket", socket_connection);
+    }
+    else if (!opt.shm_client.empty()) {
+        run_client_tests("shm", shm_connection);
+    }
+    else if (opt.inprocess_client) {
+        run_client_tests("inprocess", inprocess_connection);
+    }
+    else if (!opt.mix.empty()) {
+        mixed_tests();
+    }
+    else if (opt.open_loop) {
+        open_loop_tests();
+    }
+    else {
+        for (const auto& key : opt.keys) {
+            one_test(key, EVP_sha256());  // or 384 for 3072, 512 for 4096
+        }
+    }
 
     // OpenSSL cleanup.
     EVP_cleanup();
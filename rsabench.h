@@ -0,0 +1,540 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Common definitions for all rsabench modules.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <cstdlib>
+#include <cstdint>
+#include <cinttypes>
+
+#include <openssl/opensslv.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/err.h>
+
+constexpr int64_t USECPERSEC = 1000000;  // microseconds per second
+constexpr int64_t NSECPERSEC = 1000000000;  // nanoseconds per second
+constexpr int64_t MIN_CPU_TIME = 2 * USECPERSEC;
+constexpr size_t  INNER_LOOP_COUNT = 10;
+constexpr int64_t DEFAULT_SERIES_INTERVAL = 100000;  // time series interval with --soak, in microseconds
+
+
+//----------------------------------------------------------------------------
+// Command line options.
+//----------------------------------------------------------------------------
+
+// One operation in a mixed workload.
+struct MixEntry
+{
+    std::string op {};      // operation name
+    std::string key {};     // key name, as in --keys
+    double      weight = 0; // relative weight in the workload
+};
+
+struct Options
+{
+    std::vector<std::string> keys {"2048", "3072", "4096"};  // key sizes, as in keys file names
+    std::vector<std::string> exponents {};  // public exponents, as in keys file names, empty means 65537 only
+    std::vector<std::string> ops {};     // operation names, empty means all
+    size_t   threads = 1;                // number of threads in each closed-loop test
+    bool     mem_stats = false;          // report OpenSSL memory allocations in each test loop
+    bool     pool_alloc = false;         // use a thread-local pool allocator in OpenSSL
+    bool     perf = false;               // report hardware performance counters in each test loop
+    bool     energy = false;             // report RAPL energy consumption in each test loop
+    int64_t  loop_time = MIN_CPU_TIME;   // duration of each closed-loop test in microseconds
+    int64_t  series_interval = 0;        // time series interval in microseconds, 0 means none
+    bool     open_loop = false;          // run open-loop latency tests
+    bool     poisson = false;            // open-loop: Poisson arrivals instead of constant rate
+    size_t   workers = 0;                // open-loop: number of worker threads, 0 means number of CPU's
+    int64_t  duration = MIN_CPU_TIME;    // open-loop: duration of each load point in microseconds
+    std::vector<double> rates {};        // open-loop: offered loads in op/s, empty means automatic
+    double   slo_p99 = 0.0;              // open-loop: SLO on p99 latency in microseconds
+    std::vector<MixEntry> mix {};        // mixed workload, with open-loop arrivals, empty means none
+    std::string server {};               // daemon: Unix socket path to serve
+    std::string client {};               // daemon: Unix socket path to connect to
+    size_t   batch = 1;                  // daemon: max number of requests in a micro-batch
+    int64_t  batch_wait = 0;             // daemon: max time to wait for a full batch in microseconds
+    size_t   connections = 1;            // daemon: number of client connections
+    std::string shm_server {};           // shared memory ring: name of region to serve
+    std::string shm_client {};           // shared memory ring: name of region to connect to
+    bool     inprocess_client = false;   // run the client with in-process calls, as a reference
+    bool     alloc_matrix = false;       // run all tests in child processes with each malloc library
+    std::vector<size_t> threads_list {}; // alloc matrix: thread counts, empty means 1 and number of CPU's
+    std::vector<std::string> child_args {};  // options to pass to child processes
+    std::vector<std::string> backends {};    // crypto backends, empty means OpenSSL only
+    bool     isa_sweep = false;          // run all tests in child processes with instruction set extensions masked off
+    bool     ifma_ab = false;            // run all tests in child processes with and without AVX-512 IFMA
+    bool     phases = false;             // time each phase of the operations separately
+    bool     tls = false;                // run TLS handshakes between an in-process client and server
+    bool     x509 = false;               // run X.509 certificate chain verifications
+    bool     cms = false;                // run CMS signing and enveloping tests
+    size_t   doc_size = 4096;            // CMS: size of documents in bytes
+    size_t   recipients = 3;             // CMS: test enveloping to 1 to n recipients
+    bool     jwt = false;                // run JWT signing and verification tests
+};
+
+extern Options opt;
+
+
+//----------------------------------------------------------------------------
+// Common utilities.
+//----------------------------------------------------------------------------
+
+// Get current CPU time resource usage in microseconds.
+int64_t cpu_time();
+
+// Get current monotonic wall-clock time in nanoseconds.
+int64_t wall_time_ns();
+
+// OpenSSL error, abort application.
+[[noreturn]] void fatal(const std::string& message);
+
+// Get current executable path.
+std::string current_exec();
+
+// Get directory of keys. Abort on error.
+std::string keys_directory();
+
+// Get the number of CPU's which are available to this process.
+size_t cpu_count();
+
+// Print the description of the host: CPU, caches, kernel, virtualization.
+void print_host_info();
+
+// Print one test result.
+void print_result(const char* name, uint64_t count, uint64_t size, uint64_t duration);
+
+// Run a function in a closed loop during the test duration and print the result. Size is per call.
+void timed_loop(const char* name, uint64_t size, const std::function<void()>& func);
+
+// Same as timed_loop() in several threads. The factory creates the function for each thread.
+void parallel_loop(const char* name, uint64_t size, size_t threads_count, const std::function<std::function<void()>()>& factory);
+
+// Latency statistics, in microseconds, from a list of latencies in nanoseconds.
+struct LatencyStats
+{
+    LatencyStats(std::vector<int64_t>& latencies);  // the list is sorted in place
+    size_t count = 0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double p999 = 0.0;
+    double max = 0.0;
+};
+
+
+//----------------------------------------------------------------------------
+// Memory allocation accounting in OpenSSL.
+//----------------------------------------------------------------------------
+
+struct MemStats
+{
+    uint64_t mallocs = 0;   // number of malloc calls
+    uint64_t reallocs = 0;  // number of realloc calls
+    uint64_t frees = 0;     // number of free calls
+    uint64_t bytes = 0;     // total allocated bytes
+    int64_t  live = 0;      // currently allocated bytes
+    int64_t  peak = 0;      // peak of allocated bytes since last reset
+};
+
+// Install the allocation hooks, for accounting and/or pool allocator (see options).
+// Must be called before any OpenSSL call.
+void install_mem_hooks();
+
+// Get current statistics.
+MemStats mem_stats();
+
+// Reset the peak value to the current live size.
+void mem_reset_peak();
+
+// Print allocation statistics of a test loop.
+void print_mem_stats(const char* name, uint64_t count, const MemStats& start, const MemStats& end);
+
+// Size-class thread-local pool allocator.
+void* pool_malloc(size_t size);
+void* pool_realloc(void* ptr, size_t size);
+void  pool_free(void* ptr);
+
+
+//----------------------------------------------------------------------------
+// Hardware performance counters.
+//----------------------------------------------------------------------------
+
+// Counter values, scaled and extrapolated, indexed by event name.
+// With the cycles, "time-enabled-ns" is the running time of the thread.
+using PerfValues = std::map<std::string, double>;
+
+// Performance counters of the calling thread. Unavailable counters are ignored.
+class PerfCounters
+{
+public:
+    // With cycles_only, open the cycles counter only, silently ignore errors.
+    PerfCounters(bool cycles_only = false);
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Reset and start all counters.
+    void start();
+
+    // Stop all counters and get their values.
+    PerfValues stop();
+
+private:
+    struct Group
+    {
+        std::vector<int> fds {};  // first one is the group leader
+        std::vector<std::pair<std::string, double>> events {};  // event name and scale
+    };
+    std::vector<Group> _groups {};
+};
+
+// Accumulate counter values from several threads.
+void add_perf_values(PerfValues& total, const PerfValues& values);
+
+// Print the counter values of a test loop: per-operation counts, IPC, top-down fractions.
+void print_perf_values(const char* name, uint64_t count, const PerfValues& values);
+
+// Effective CPU frequency in MHz during a test loop, from the cycles counter.
+// Return zero without cycles counter.
+double effective_mhz(const PerfValues& values);
+
+// CPU frequency in MHz just after a test, using a 5 ms calibrated busy loop in the calling
+// thread. This is not the frequency during the test. Return zero on unsupported CPU's.
+double post_test_mhz();
+
+
+//----------------------------------------------------------------------------
+// Energy consumption, using the Linux powercap interface (RAPL).
+//----------------------------------------------------------------------------
+
+struct EnergySample
+{
+    int64_t time = 0;                   // wall-clock time in nanoseconds
+    std::vector<uint64_t> counters {};  // energy in microjoules, one per RAPL domain
+};
+
+// Get a snapshot of all energy counters.
+EnergySample energy_sample();
+
+// Print the energy consumption of a test loop, nothing if RAPL is unavailable.
+void print_energy(const char* name, uint64_t count, const EnergySample& start, const EnergySample& end);
+
+
+//----------------------------------------------------------------------------
+// Throughput time series: number of operations in fixed wall-clock intervals.
+//----------------------------------------------------------------------------
+
+struct TimeSeries
+{
+    TimeSeries(int64_t start_ns, int64_t interval_ns);
+    void add(int64_t now_ns, uint64_t ops);  // count operations completed at this time
+    void merge(const TimeSeries& other);     // add the series of another thread, same start and interval
+    int64_t start;                           // wall-clock time in nanoseconds
+    int64_t interval;                        // in nanoseconds
+    std::vector<uint64_t> counts {};         // number of operations per interval
+};
+
+// Print a time series and its initial, steady-state and minimum rates.
+void print_time_series(const char* name, const TimeSeries& series);
+
+
+//----------------------------------------------------------------------------
+// RSA key pair, loaded from the keys directory.
+//----------------------------------------------------------------------------
+
+class RSAKeys
+{
+public:
+    // The name is the common prefix of the key files, e.g. "rsa-2048" or "rsa-2048-e3".
+    RSAKeys(const std::string& name);
+    ~RSAKeys();
+    RSAKeys(const RSAKeys&) = delete;
+    RSAKeys& operator=(const RSAKeys&) = delete;
+
+    EVP_PKEY* priv() const { return _priv; }
+    EVP_PKEY* pub() const { return _pub; }
+    size_t bits() const { return EVP_PKEY_get_bits(_priv); }
+    size_t size() const { return EVP_PKEY_get_size(_priv); }
+    std::string algo() const;
+    std::string exponent() const;
+
+private:
+    EVP_PKEY* _priv = nullptr;
+    EVP_PKEY* _pub = nullptr;
+    std::string _variant {};  // suffix of the name after the key size, e.g. "-e3"
+};
+
+
+//----------------------------------------------------------------------------
+// One RSA operation on a key pair, repeatedly executed in a test loop.
+// An instance shall be used by one thread only. All input data are
+// prepared in the constructor: running the operation has no side effect.
+//----------------------------------------------------------------------------
+
+enum RSAOpType {OAEP_ENCRYPT, OAEP_DECRYPT, PSS_SIGN, PSS_VERIFY};
+constexpr size_t RSA_OP_COUNT = 4;
+
+// Name of operations, as used in the output.
+const char* op_name(RSAOpType type);
+
+// Get an operation type from its name, either full ("pss-sign") or short ("sign"). Abort on error.
+RSAOpType op_type(const std::string& name);
+
+// Base class of operations, for all crypto backends.
+class BackendOperation
+{
+public:
+    virtual ~BackendOperation() = default;
+    BackendOperation(const BackendOperation&) = delete;
+    BackendOperation& operator=(const BackendOperation&) = delete;
+
+    // Run the operation once. Abort on error.
+    virtual void run() = 0;
+
+    // Operation type and name.
+    RSAOpType type() const { return _type; }
+    const char* name() const { return op_name(_type); }
+
+    // Number of data bytes which are accounted for one operation.
+    size_t data_size() const { return _data_size; }
+
+    // Print operation-specific information after a test.
+    void print_info() const;
+
+    // Check the result of the last operation. Abort on error.
+    void check() const;
+
+protected:
+    BackendOperation(RSAOpType type) : _type(type) {}
+
+    // Input data of half the max output size for the algorithm, or the message digest to sign.
+    void init_plain(size_t key_size, const EVP_MD* pss_hash);
+
+    // Prepare the input data from the plain data, using run(). Decryption and verification
+    // need the result of an encryption or a signature, computed with the same operation.
+    void init_input(size_t key_size);
+
+    RSAOpType     _type;
+    size_t        _data_size = 0;
+    std::vector<uint8_t> _plain {};   // plain data (encrypt, decrypt) or digest (sign, verify)
+    std::vector<uint8_t> _input {};   // input of the operation
+    std::vector<uint8_t> _output {};  // output of the operation
+    size_t        _output_len = 0;
+};
+
+// Operation with OpenSSL, the default backend.
+class RSAOperation : public BackendOperation
+{
+public:
+    RSAOperation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash = EVP_sha256());
+    virtual ~RSAOperation() override;
+    virtual void run() override;
+
+    // Input data of the operation, as sent to a remote service. For a signature
+    // verification, this is the signature, followed by the signed digest.
+    std::vector<uint8_t> request_data() const;
+
+    // Max size of the output of the operation.
+    size_t output_capacity() const { return _output.size(); }
+
+    // Run the operation once on externally provided data (same format as request_data()).
+    // On input, output_size is the capacity of the output buffer. On output, it is the
+    // size of the output data, zero for a verification. Return false on error, without aborting.
+    bool process(const uint8_t* input, size_t input_size, uint8_t* output, size_t& output_size);
+
+private:
+    EVP_PKEY_CTX* _ctx = nullptr;
+
+    static EVP_PKEY_CTX* new_context(EVP_PKEY* key, RSAOpType type, const EVP_MD* pss_hash);
+};
+
+
+//----------------------------------------------------------------------------
+// Crypto backends: the libraries which implement the RSA operations.
+//----------------------------------------------------------------------------
+
+// Components of an RSA key pair, as big-endian byte arrays, for other libraries.
+struct RSAKeyComponents
+{
+    std::vector<uint8_t> n {};     // modulus
+    std::vector<uint8_t> e {};     // public exponent
+    std::vector<uint8_t> d {};     // private exponent
+    std::vector<uint8_t> p {};     // first prime factor
+    std::vector<uint8_t> q {};     // second prime factor
+    std::vector<uint8_t> dp {};    // d mod (p-1)
+    std::vector<uint8_t> dq {};    // d mod (q-1)
+    std::vector<uint8_t> qinv {};  // q^-1 mod p
+};
+
+// Get the components of a key pair. Abort on error.
+RSAKeyComponents key_components(const RSAKeys& keys);
+
+// Number of significant bits in a big-endian number.
+size_t bit_length(const std::vector<uint8_t>& bytes);
+
+class Backend
+{
+public:
+    virtual ~Backend() = default;
+
+    // Backend name, as used on the command line, and library version.
+    virtual std::string name() const = 0;
+    virtual std::string version() const = 0;
+
+    // Create an operation on a key pair. Abort on error, including unsupported PSS hash.
+    virtual BackendOperation* new_operation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash) = 0;
+};
+
+// Get the names of all backends which are compiled in.
+std::vector<std::string> backend_names();
+
+// Get a backend by name. Abort if not compiled in.
+Backend& get_backend(const std::string& name);
+
+// Get the backend to use in the current process: the first of --backend or OpenSSL.
+Backend& current_backend();
+
+// Run the tests of all specified backends in child processes and compare them.
+void backend_tests();
+
+// Base class for backends which only provide raw modular exponentiations.
+// The OAEP and PSS paddings are computed with OpenSSL.
+class RawOperation : public BackendOperation
+{
+protected:
+    RawOperation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash);
+
+    // Prepare the input data. Must be called at the end of the constructor of the subclass.
+    void init();
+
+    // Raw RSA operations, on big-endian numbers of the key size.
+    virtual void raw_private(const uint8_t* in, uint8_t* out) = 0;
+    virtual void raw_public(const uint8_t* in, uint8_t* out) = 0;
+
+    // Run one operation, using the raw operations.
+    virtual void run() override;
+
+    const RSAKeys& _keys;
+    const EVP_MD*  _md;
+    std::vector<uint8_t> _padded {};  // encoded message, before or after the raw operation
+};
+
+// Backend factories, when compiled in.
+Backend* new_gcrypt_backend();
+Backend* new_nettle_backend();
+Backend* new_mbedtls_backend();
+Backend* new_gmp_backend();
+
+// Built-in Montgomery engine, one backend per kernel which is supported by the CPU.
+std::vector<Backend*> new_mont_backends();
+
+
+//----------------------------------------------------------------------------
+// Test modes, in separate modules.
+//----------------------------------------------------------------------------
+
+// Run open-loop latency tests.
+void open_loop_tests();
+
+// Run a mixed workload of operations, with open-loop arrivals.
+void mixed_tests();
+
+// Run the signing daemon on a Unix socket, never return.
+[[noreturn]] void run_server();
+
+// Run the RSA offload service on a shared memory ring, never return.
+[[noreturn]] void run_shm_server();
+
+// Statistics of one client connection, in nanoseconds.
+struct ClientStats
+{
+    std::vector<int64_t> latency {};  // end-to-end latency of each request
+    int64_t queue = 0;                // cumulated time in server queue
+    int64_t service = 0;              // cumulated time in RSA operations
+    int64_t batch = 0;                // cumulated size of server batches, zero if not applicable
+};
+
+// A client connection: run requests in closed loop on an operation until the end time (nanoseconds).
+using ClientConnection = void (*)(const RSAKeys& keys, const RSAOperation& op, int64_t end, ClientStats& stats);
+
+// Run client tests on all keys and operations, using --connections concurrent connections.
+// The transport name is used in the output.
+void run_client_tests(const std::string& transport, ClientConnection connection);
+
+// Client connections for the various transports.
+void inprocess_connection(const RSAKeys& keys, const RSAOperation& op, int64_t end, ClientStats& stats);
+void socket_connection(const RSAKeys& keys, const RSAOperation& op, int64_t end, ClientStats& stats);
+void shm_connection(const RSAKeys& keys, const RSAOperation& op, int64_t end, ClientStats& stats);
+
+
+//----------------------------------------------------------------------------
+// Tests in child processes.
+//----------------------------------------------------------------------------
+
+// Result of rsabench in a child process.
+struct ChildResult
+{
+    bool success = false;                 // child process terminated successfully
+    std::string output {};                // complete standard output
+    int64_t max_rss_kb = 0;               // max resident set size in kilobytes
+    std::vector<std::string> tests {};    // test names ("algo op"), in order of execution
+    std::map<std::string, double> persec {};  // operations per second, indexed by test name
+};
+
+// Run rsabench in a child process with additional environment variables.
+ChildResult run_child(const std::vector<std::string>& args, const std::vector<std::pair<std::string, std::string>>& env);
+
+// Print a comparison table of the throughput of several child processes.
+void print_comparison(const std::vector<std::string>& titles, const std::vector<ChildResult>& results, bool with_rss);
+
+// Print a table with aligned columns, the first line is the header.
+void print_table(const std::vector<std::vector<std::string>>& lines);
+
+// Run all tests with each allocator, at several thread counts.
+void alloc_matrix_tests();
+
+// Options for a child process which runs the same tests as this process.
+std::vector<std::string> same_test_args();
+
+// Get the CPU capability vector of OpenSSL: environment variable name and values.
+bool openssl_cpu_caps(std::string& name, std::vector<uint64_t>& values);
+
+// Run all tests with some instruction set extensions masked off in OpenSSL.
+void isa_sweep_tests();
+
+// Run all tests with and without the AVX-512 IFMA code path of OpenSSL.
+void ifma_ab_tests();
+
+// Name of the code path which is used by OpenSSL for the modular exponentiation of an operation.
+std::string openssl_code_path(const RSAKeys& keys, RSAOpType type);
+
+// Time each phase of the RSA operations: hash, padding, random, conversions, modular exponentiation.
+void phase_tests();
+
+// Create a certificate for a public key, signed by an issuer, self-signed when the issuer is null.
+X509* new_certificate(const std::string& name, EVP_PKEY* key, EVP_PKEY* issuer_key, X509* issuer, bool ca);
+
+// Run TLS handshakes between an in-process client and server over memory BIO's.
+void tls_tests();
+
+// Run X.509 certificate chain verifications on a local CA hierarchy.
+void x509_tests();
+
+// Run CMS signing (RSA-PSS) and enveloping (RSA-OAEP) of documents.
+void cms_tests();
+
+// Run JWT signing and verification with RS256, PS256, PS512.
+void jwt_tests();
@@ -0,0 +1,430 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// RSA key pairs and RSA operations.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <cstring>
+#include <openssl/core_names.h>
+
+
+//----------------------------------------------------------------------------
+// Load a key pair from the keys directory. Abort on error.
+//----------------------------------------------------------------------------
+
+RSAKeys::RSAKeys(const std::string& name)
+{
+    const std::string dir(keys_directory() + "/");
+    const std::string kpriv_file(dir + name + "-prv.pem");
+    const std::string kpub_file(dir + name + "-pub.pem");
+
+    std::FILE* fp = nullptr;
+    if ((fp = std::fopen(kpriv_file.c_str(), "r")) == nullptr) {
+        perror(kpriv_file.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+    _priv = PEM_read_PrivateKey(fp, nullptr, nullptr, nullptr);
+    if (_priv == nullptr) {
+        fatal("error loading private key from " + kpriv_file);
+    }
+    fclose(fp);
+
+    if ((fp = std::fopen(kpub_file.c_str(), "r")) == nullptr) {
+        perror(kpub_file.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+    _pub = PEM_read_PUBKEY(fp, nullptr, nullptr, nullptr);
+    if (_pub == nullptr) {
+        fatal("error loading public key from " + kpub_file);
+    }
+    fclose(fp);
+
+    // Key variant, after "rsa-<bits>", e.g. "-e3" for a public exponent 3.
+    const size_t dash = name.find('-', name.find_first_of("0123456789"));
+    if (dash != std::string::npos) {
+        _variant = name.substr(dash);
+    }
+
+    // Check key size consistency.
+    if (EVP_PKEY_get_bits(_priv) != EVP_PKEY_get_bits(_pub) || EVP_PKEY_get_size(_priv) != EVP_PKEY_get_size(_pub)) {
+        fatal("internal error: inconsistent key sizes");
+    }
+}
+
+RSAKeys::~RSAKeys()
+{
+    EVP_PKEY_free(_pub);
+    EVP_PKEY_free(_priv);
+}
+
+std::string RSAKeys::algo() const
+{
+    return EVP_PKEY_get0_type_name(_priv) + std::string("-") + std::to_string(bits()) + _variant;
+}
+
+std::string RSAKeys::exponent() const
+{
+    BIGNUM* e = nullptr;
+    if (!EVP_PKEY_get_bn_param(_pub, OSSL_PKEY_PARAM_RSA_E, &e)) {
+        fatal("error getting RSA public exponent");
+    }
+    char* str = BN_bn2dec(e);
+    const std::string result(str == nullptr ? "?" : str);
+    OPENSSL_free(str);
+    BN_free(e);
+    return result;
+}
+
+
+//----------------------------------------------------------------------------
+// Get the components of a key pair, for other libraries. Abort on error.
+//----------------------------------------------------------------------------
+
+RSAKeyComponents key_components(const RSAKeys& keys)
+{
+    RSAKeyComponents comp;
+    const std::pair<const char*, std::vector<uint8_t>*> params[] = {
+        {OSSL_PKEY_PARAM_RSA_N, &comp.n},
+        {OSSL_PKEY_PARAM_RSA_E, &comp.e},
+        {OSSL_PKEY_PARAM_RSA_D, &comp.d},
+        {OSSL_PKEY_PARAM_RSA_FACTOR1, &comp.p},
+        {OSSL_PKEY_PARAM_RSA_FACTOR2, &comp.q},
+        {OSSL_PKEY_PARAM_RSA_EXPONENT1, &comp.dp},
+        {OSSL_PKEY_PARAM_RSA_EXPONENT2, &comp.dq},
+        {OSSL_PKEY_PARAM_RSA_COEFFICIENT1, &comp.qinv},
+    };
+    for (const auto& param : params) {
+        BIGNUM* bn = nullptr;
+        if (!EVP_PKEY_get_bn_param(keys.priv(), param.first, &bn)) {
+            fatal(std::string("error getting RSA key component ") + param.first);
+        }
+        param.second->resize(BN_num_bytes(bn));
+        BN_bn2bin(bn, param.second->data());
+        BN_clear_free(bn);
+    }
+    return comp;
+}
+
+
+//----------------------------------------------------------------------------
+// Operation names.
+//----------------------------------------------------------------------------
+
+const char* op_name(RSAOpType type)
+{
+    switch (type) {
+        case OAEP_ENCRYPT: return "oaep-encrypt";
+        case OAEP_DECRYPT: return "oaep-decrypt";
+        case PSS_SIGN: return "pss-sign";
+        case PSS_VERIFY: return "pss-verify";
+        default: return "unknown";
+    }
+}
+
+RSAOpType op_type(const std::string& name)
+{
+    for (size_t i = 0; i < RSA_OP_COUNT; i++) {
+        const std::string full(op_name(RSAOpType(i)));
+        if (name == full || name == full.substr(full.find('-') + 1)) {
+            return RSAOpType(i);
+        }
+    }
+    std::cerr << "rsabench: invalid operation name '" << name << "'" << std::endl;
+    std::exit(EXIT_FAILURE);
+}
+
+
+//----------------------------------------------------------------------------
+// Create and initialize an EVP context for one type of operation.
+//----------------------------------------------------------------------------
+
+EVP_PKEY_CTX* RSAOperation::new_context(EVP_PKEY* key, RSAOpType type, const EVP_MD* pss_hash)
+{
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new(key, nullptr);
+    if (ctx == nullptr) {
+        fatal(type == OAEP_ENCRYPT || type == PSS_VERIFY ? "error in EVP_PKEY_CTX_new(public-key)" : "error in EVP_PKEY_CTX_new(private-key)");
+    }
+    switch (type) {
+        case OAEP_ENCRYPT:
+            if (EVP_PKEY_encrypt_init(ctx) <= 0) {
+                fatal("error in EVP_PKEY_encrypt_init");
+            }
+            break;
+        case OAEP_DECRYPT:
+            if (EVP_PKEY_decrypt_init(ctx) <= 0) {
+                fatal("error in EVP_PKEY_decrypt_init");
+            }
+            break;
+        case PSS_SIGN:
+            if (EVP_PKEY_sign_init(ctx) <= 0) {
+                fatal("error in EVP_PKEY_sign_init");
+            }
+            break;
+        case PSS_VERIFY:
+            if (EVP_PKEY_verify_init(ctx) <= 0) {
+                fatal("error in EVP_PKEY_verify_init");
+            }
+            break;
+    }
+    if (type == OAEP_ENCRYPT || type == OAEP_DECRYPT) {
+        if (EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) <= 0) {
+            fatal("error in EVP_PKEY_CTX_set_rsa_padding(RSA_PKCS1_OAEP_PADDING)");
+        }
+    }
+    else {
+        if (EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_PSS_PADDING) <= 0) {
+            fatal("error in EVP_PKEY_CTX_set_rsa_padding");
+        }
+        if (EVP_PKEY_CTX_set_signature_md(ctx, pss_hash) <= 0) {
+            fatal("error in EVP_PKEY_CTX_set_signature_md");
+        }
+        // Explicit salt length, the default depends on the OpenSSL version.
+        if (EVP_PKEY_CTX_set_rsa_pss_saltlen(ctx, RSA_PSS_SALTLEN_DIGEST) <= 0) {
+            fatal("error in EVP_PKEY_CTX_set_rsa_pss_saltlen");
+        }
+    }
+    return ctx;
+}
+
+
+//----------------------------------------------------------------------------
+// Prepare one operation.
+//----------------------------------------------------------------------------
+
+void BackendOperation::init_plain(size_t key_size, const EVP_MD* pss_hash)
+{
+    // Use input data of half the max output size for the algorithm.
+    // This is the usual scheme: RSA-2048 -> 256 bytes -> sign/encrypt 128-bit data.
+    // The signed data is a message digest.
+    if (_type == OAEP_ENCRYPT || _type == OAEP_DECRYPT) {
+        _plain.assign(key_size / 2, 0xA5);
+        _output.resize(key_size);
+    }
+    else {
+        _plain.assign(EVP_MD_get_size(pss_hash), 0x5A);
+        _output.resize(1024);
+    }
+}
+
+void BackendOperation::init_input(size_t key_size)
+{
+    switch (_type) {
+        case OAEP_ENCRYPT:
+            _input = _plain;
+            _data_size = _input.size();
+            break;
+        case OAEP_DECRYPT:
+            _type = OAEP_ENCRYPT;
+            _input = _plain;
+            run();
+            _type = OAEP_DECRYPT;
+            _input.assign(_output.begin(), _output.begin() + _output_len);
+            _data_size = _input.size();
+            break;
+        case PSS_SIGN:
+            _input = _plain;
+            _data_size = key_size / 2;
+            break;
+        case PSS_VERIFY:
+            _type = PSS_SIGN;
+            _input = _plain;
+            run();
+            _type = PSS_VERIFY;
+            _input.assign(_output.begin(), _output.begin() + _output_len);
+            _data_size = _input.size();
+            break;
+    }
+    _output_len = 0;
+}
+
+RSAOperation::RSAOperation(const RSAKeys& keys, RSAOpType type, const EVP_MD* pss_hash) :
+    BackendOperation(type)
+{
+    const size_t key_size = keys.size();
+    init_plain(key_size, pss_hash);
+
+    // The context of the operation is specific to its type. The ciphertext or
+    // signature of the plain data is computed with a temporary context.
+    EVP_PKEY_CTX* ctx = nullptr;
+    switch (type) {
+        case OAEP_ENCRYPT:
+            _input = _plain;
+            _data_size = _input.size();
+            _ctx = new_context(keys.pub(), type, pss_hash);
+            break;
+        case OAEP_DECRYPT:
+            ctx = new_context(keys.pub(), OAEP_ENCRYPT, pss_hash);
+            _output_len = _output.size();
+            if (EVP_PKEY_encrypt(ctx, _output.data(), &_output_len, _plain.data(), _plain.size()) <= 0) {
+                fatal("RSA encrypt error");
+            }
+            _input.assign(_output.begin(), _output.begin() + _output_len);
+            _data_size = _input.size();
+            _ctx = new_context(keys.priv(), type, pss_hash);
+            break;
+        case PSS_SIGN:
+            _input = _plain;
+            _data_size = key_size / 2;
+            _ctx = new_context(keys.priv(), type, pss_hash);
+            break;
+        case PSS_VERIFY:
+            ctx = new_context(keys.priv(), PSS_SIGN, pss_hash);
+            _output_len = _output.size();
+            if (EVP_PKEY_sign(ctx, _output.data(), &_output_len, _plain.data(), _plain.size()) <= 0) {
+                fatal("RSA sign error");
+            }
+            _input.assign(_output.begin(), _output.begin() + _output_len);
+            _data_size = _input.size();
+            _ctx = new_context(keys.pub(), type, pss_hash);
+            break;
+    }
+    EVP_PKEY_CTX_free(ctx);
+    _output_len = 0;
+}
+
+RSAOperation::~RSAOperation()
+{
+    EVP_PKEY_CTX_free(_ctx);
+}
+
+
+//----------------------------------------------------------------------------
+// Run the operation once.
+//----------------------------------------------------------------------------
+
+void RSAOperation::run()
+{
+    _output_len = _output.size();
+    switch (_type) {
+        case OAEP_ENCRYPT:
+            if (EVP_PKEY_encrypt(_ctx, _output.data(), &_output_len, _input.data(), _input.size()) <= 0) {
+                fatal("RSA encrypt error");
+            }
+            break;
+        case OAEP_DECRYPT:
+            if (EVP_PKEY_decrypt(_ctx, _output.data(), &_output_len, _input.data(), _input.size()) <= 0) {
+                fatal("RSA decrypt error");
+            }
+            break;
+        case PSS_SIGN:
+            if (EVP_PKEY_sign(_ctx, _output.data(), &_output_len, _input.data(), _input.size()) <= 0) {
+                fatal("RSA sign error");
+            }
+            break;
+        case PSS_VERIFY:
+            // Status: 1=verified, 0=not verified, <0 = error
+            if (EVP_PKEY_verify(_ctx, _input.data(), _input.size(), _plain.data(), _plain.size()) <= 0) {
+                fatal("RSA verify error");
+            }
+            break;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Print operation-specific information after a test.
+//----------------------------------------------------------------------------
+
+void BackendOperation::print_info() const
+{
+    switch (_type) {
+        case OAEP_ENCRYPT:
+            std::cout << "encrypted-size: " << _output_len << std::endl;
+            break;
+        case OAEP_DECRYPT:
+            std::cout << "decrypted-size: " << _output_len << std::endl;
+            break;
+        case PSS_SIGN:
+            std::cout << "pss-digest-size: " << (8 * _plain.size()) << std::endl;
+            std::cout << "signature-size: " << _output_len << std::endl;
+            break;
+        case PSS_VERIFY:
+            break;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Check the result of the last operation.
+//----------------------------------------------------------------------------
+
+void BackendOperation::check() const
+{
+    if (_type == OAEP_DECRYPT && (_output_len != _plain.size() || memcmp(_plain.data(), _output.data(), _output_len) != 0)) {
+        fatal("decrypted data don't match input");
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Input data of the operation, as sent to a remote service.
+//----------------------------------------------------------------------------
+
+std::vector<uint8_t> RSAOperation::request_data() const
+{
+    std::vector<uint8_t> data(_input);
+    if (_type == PSS_VERIFY) {
+        data.insert(data.end(), _plain.begin(), _plain.end());
+    }
+    return data;
+}
+
+
+//----------------------------------------------------------------------------
+// Run the operation once on externally provided data.
+//----------------------------------------------------------------------------
+
+bool RSAOperation::process(const uint8_t* input, size_t input_size, uint8_t* output, size_t& output_size)
+{
+    size_t len = output_size;
+    int status = 0;
+
+    switch (_type) {
+        case OAEP_ENCRYPT:
+            status = EVP_PKEY_encrypt(_ctx, output, &len, input, input_size);
+            break;
+        case OAEP_DECRYPT:
+            status = EVP_PKEY_decrypt(_ctx, output, &len, input, input_size);
+            break;
+        case PSS_SIGN:
+            status = EVP_PKEY_sign(_ctx, output, &len, input, input_size);
+            break;
+        case PSS_VERIFY:
+            len = 0;
+            if (input_size > _plain.size()) {
+                const size_t sig_size = input_size - _plain.size();
+                status = EVP_PKEY_verify(_ctx, input, sig_size, input + sig_size, _plain.size());
+            }
+            break;
+    }
+    if (status <= 0) {
+        ERR_clear_error();
+        output_size = 0;
+        return false;
+    }
+    output_size = len;
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// Number of significant bits in a big-endian number.
+//----------------------------------------------------------------------------
+
+size_t bit_length(const std::vector<uint8_t>& bytes)
+{
+    for (size_t i = 0; i < bytes.size(); i++) {
+        if (bytes[i] != 0) {
+            size_t bits = (bytes.size() - i) * 8;
+            for (uint8_t mask = 0x80; (bytes[i] & mask) == 0; mask >>= 1) {
+                bits--;
+            }
+            return bits;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,341 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Local RSA offload service over a lock-free shared memory ring.
+//
+// A socket round-trip costs more than an RSA-2048 verification. Here, the
+// shared memory region contains a fixed array of request slots and two
+// lock-free bounded MPMC queues of slot indexes (D. Vyukov's algorithm):
+// the free slots and the submitted requests. A client process takes a
+// slot, writes its request in place, submits the slot index and polls the
+// slot state. A server worker thread dequeues the slot index, runs the RSA
+// operation from the slot input directly into the slot output, then marks
+// the slot as completed. No data is copied between the processes and no
+// system call is made on the request path.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <map>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+constexpr uint32_t SHM_MAGIC = 0x5253414D;  // "RSAM"
+constexpr uint32_t SLOT_COUNT = 256;        // must be a power of 2
+constexpr size_t   SLOT_DATA_SIZE = 1024;   // max input or output size
+
+// Atomics in shared memory must not rely on a process-local lock.
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "64-bit atomics are not lock-free");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "32-bit atomics are not lock-free");
+
+namespace {
+    enum SlotState : uint32_t {SLOT_IDLE, SLOT_SUBMITTED, SLOT_DONE};
+
+    // One request slot, written by the client, completed in place by the server.
+    struct alignas(64) Slot
+    {
+        std::atomic<uint32_t> state;
+        uint32_t op;              // RSAOpType
+        uint32_t input_size;
+        uint32_t output_size;
+        uint32_t status;          // 1 = success, 0 = error
+        int64_t  submitted;       // wall time in nanoseconds (the monotonic clock is system-wide)
+        uint64_t queue_ns;        // time in server queue
+        uint64_t service_ns;      // time in RSA operation
+        char     key[32];         // key name, RSAKeys::algo(), e.g. "RSA-2048-e3"
+        uint8_t  input[SLOT_DATA_SIZE];
+        uint8_t  output[SLOT_DATA_SIZE];
+    };
+
+    // Lock-free bounded multi-producer multi-consumer queue of slot indexes.
+    class IndexQueue
+    {
+    public:
+        void init()
+        {
+            for (uint32_t i = 0; i < SLOT_COUNT; i++) {
+                _cells[i].seq.store(i, std::memory_order_relaxed);
+            }
+            _head.store(0, std::memory_order_relaxed);
+            _tail.store(0, std::memory_order_relaxed);
+        }
+
+        bool push(uint32_t value)
+        {
+            uint64_t pos = _tail.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell(_cells[pos & (SLOT_COUNT - 1)]);
+                const int64_t diff = int64_t(cell.seq.load(std::memory_order_acquire)) - int64_t(pos);
+                if (diff == 0) {
+                    if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        cell.value = value;
+                        cell.seq.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0) {
+                    return false;  // full
+                }
+                else {
+                    pos = _tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool pop(uint32_t& value)
+        {
+            uint64_t pos = _head.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell(_cells[pos & (SLOT_COUNT - 1)]);
+                const int64_t diff = int64_t(cell.seq.load(std::memory_order_acquire)) - int64_t(pos + 1);
+                if (diff == 0) {
+                    if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        value = cell.value;
+                        cell.seq.store(pos + SLOT_COUNT, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0) {
+                    return false;  // empty
+                }
+                else {
+                    pos = _head.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<uint64_t> seq;
+            uint32_t value;
+        };
+        alignas(64) std::atomic<uint64_t> _head;
+        alignas(64) std::atomic<uint64_t> _tail;
+        alignas(64) Cell _cells[SLOT_COUNT];
+    };
+
+    // Complete shared memory region.
+    struct Region
+    {
+        std::atomic<uint32_t> magic;  // set last by the server, when the region is initialized
+        IndexQueue free_slots;
+        IndexQueue submitted;
+        Slot slots[SLOT_COUNT];
+    };
+}
+
+
+//----------------------------------------------------------------------------
+// Wait with exponential politeness: spin, then yield, then (optionally) sleep.
+//----------------------------------------------------------------------------
+
+static void backoff(uint32_t& spins, bool can_sleep)
+{
+    if (spins < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+#endif
+    }
+    else if (!can_sleep || spins < 2048) {
+        std::this_thread::yield();
+    }
+    else {
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+    spins++;
+}
+
+
+//----------------------------------------------------------------------------
+// Map the shared memory region. Abort on error.
+//----------------------------------------------------------------------------
+
+static Region* map_region(const std::string& name, bool create)
+{
+    const int fd = ::shm_open(name.c_str(), create ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDWR, 0600);
+    if (fd < 0) {
+        perror(name.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+    if (create && ::ftruncate(fd, sizeof(Region)) < 0) {
+        perror("ftruncate");
+        std::exit(EXIT_FAILURE);
+    }
+    void* addr = ::mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        perror("mmap");
+        std::exit(EXIT_FAILURE);
+    }
+    ::close(fd);
+
+    Region* region = nullptr;
+    if (create) {
+        region = new (addr) Region;
+        region->free_slots.init();
+        region->submitted.init();
+        for (uint32_t i = 0; i < SLOT_COUNT; i++) {
+            region->slots[i].state.store(SLOT_IDLE, std::memory_order_relaxed);
+            region->free_slots.push(i);
+        }
+        region->magic.store(SHM_MAGIC, std::memory_order_release);
+    }
+    else {
+        region = reinterpret_cast<Region*>(addr);
+        if (region->magic.load(std::memory_order_acquire) != SHM_MAGIC) {
+            std::cerr << "rsabench: " << name << " is not an initialized rsabench shared memory" << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    return region;
+}
+
+
+//----------------------------------------------------------------------------
+// Server side.
+//----------------------------------------------------------------------------
+
+static std::atomic<uint64_t> shm_requests {0};
+
+// Worker thread: complete submitted requests in place.
+static void shm_worker(Region* region, const std::vector<std::unique_ptr<RSAKeys>>& keys)
+{
+    // One operation context per key and per operation type. Several keys may have
+    // the same size with distinct public exponents, the keys are identified by name.
+    std::map<std::pair<std::string, int>, std::unique_ptr<RSAOperation>> ops;
+    for (const auto& k : keys) {
+        for (size_t i = 0; i < RSA_OP_COUNT; i++) {
+            ops[std::make_pair(k->algo(), int(i))].reset(new RSAOperation(*k, RSAOpType(i)));
+        }
+    }
+
+    for (;;) {
+        uint32_t index = 0;
+        uint32_t spins = 0;
+        while (!region->submitted.pop(index)) {
+            backoff(spins, true);
+        }
+        Slot& slot(region->slots[index]);
+        const int64_t start = wall_time_ns();
+        const auto it = ops.find(std::make_pair(std::string(slot.key, strnlen(slot.key, sizeof(slot.key))), int(slot.op)));
+        size_t output_size = sizeof(slot.output);
+        const bool ok = slot.input_size <= sizeof(slot.input) && it != ops.end() &&
+                        it->second->process(slot.input, slot.input_size, slot.output, output_size);
+        const int64_t end = wall_time_ns();
+        slot.status = ok;
+        slot.output_size = uint32_t(output_size);
+        slot.queue_ns = uint64_t(start - slot.submitted);
+        slot.service_ns = uint64_t(end - start);
+        slot.state.store(SLOT_DONE, std::memory_order_release);
+        shm_requests.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// Run the shared memory server.
+void run_shm_server()
+{
+    std::vector<std::unique_ptr<RSAKeys>> keys;
+    for (const auto& key_name : opt.keys) {
+        keys.emplace_back(new RSAKeys("rsa-" + key_name));
+    }
+
+    // Termination signals are synchronously received by the main thread.
+    sigset_t sigs;
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &sigs, nullptr);
+
+    Region* region = map_region(opt.shm_server, true);
+
+    std::cout << "shm-server-name: " << opt.shm_server << std::endl;
+    std::cout << "shm-server-workers: " << opt.workers << std::endl;
+    std::cout << "shm-server-slots: " << SLOT_COUNT << std::endl;
+    for (const auto& k : keys) {
+        std::cout << "shm-server-key: " << k->algo() << std::endl;
+    }
+
+    for (size_t i = 0; i < opt.workers; i++) {
+        std::thread(shm_worker, region, std::cref(keys)).detach();
+    }
+
+    int sig = 0;
+    sigwait(&sigs, &sig);
+    ::shm_unlink(opt.shm_server.c_str());
+    std::cout << "shm-server-requests: " << shm_requests.load() << std::endl;
+    std::exit(EXIT_SUCCESS);
+}
+
+
+//----------------------------------------------------------------------------
+// Client connection: run requests in closed loop until the end time.
+//----------------------------------------------------------------------------
+
+void shm_connection(const RSAKeys& keys, const RSAOperation& op, int64_t end, ClientStats& stats)
+{
+    // The region is mapped once per client process.
+    static Region* const region = map_region(opt.shm_client, false);
+
+    // Reserve one slot for the whole test.
+    uint32_t index = 0;
+    uint32_t spins = 0;
+    while (!region->free_slots.pop(index)) {
+        backoff(spins, true);
+    }
+    Slot& slot(region->slots[index]);
+
+    const std::vector<uint8_t> data(op.request_data());
+    if (data.size() > sizeof(slot.input)) {
+        fatal("request too large for shared memory slot");
+    }
+    if (keys.algo().size() > sizeof(slot.key)) {
+        fatal("key name too long: " + keys.algo());
+    }
+
+    while (wall_time_ns() < end) {
+        // Write the request in place and submit it.
+        slot.op = uint32_t(op.type());
+        std::memset(slot.key, 0, sizeof(slot.key));
+        std::memcpy(slot.key, keys.algo().data(), keys.algo().size());
+        slot.input_size = uint32_t(data.size());
+        std::memcpy(slot.input, data.data(), data.size());
+        const int64_t start = wall_time_ns();
+        slot.submitted = start;
+        slot.state.store(SLOT_SUBMITTED, std::memory_order_release);
+        spins = 0;
+        while (!region->submitted.push(index)) {
+            backoff(spins, false);
+        }
+
+        // Poll for completion.
+        spins = 0;
+        while (slot.state.load(std::memory_order_acquire) != SLOT_DONE) {
+            backoff(spins, false);
+        }
+        stats.latency.push_back(wall_time_ns() - start);
+        if (slot.status != 1) {
+            fatal(std::string("server error on ") + op.name());
+        }
+        stats.queue += slot.queue_ns;
+        stats.service += slot.service_ns;
+    }
+
+    slot.state.store(SLOT_IDLE, std::memory_order_relaxed);
+    region->free_slots.push(index);
+}
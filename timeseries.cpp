@@ -0,0 +1,100 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// Throughput time series of a test loop.
+//
+// The completed operations are counted in fixed wall-clock intervals. On a
+// long run, the series shows the decay of the throughput when the turbo
+// budget is exhausted or when the chip is thermally throttled.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <algorithm>
+#include <cstdio>
+
+
+//----------------------------------------------------------------------------
+// Start a time series at the specified wall-clock time.
+//----------------------------------------------------------------------------
+
+TimeSeries::TimeSeries(int64_t start_ns, int64_t interval_ns) :
+    start(start_ns),
+    interval(std::max<int64_t>(interval_ns, 1))
+{
+}
+
+
+//----------------------------------------------------------------------------
+// Count operations which completed at the specified wall-clock time.
+//----------------------------------------------------------------------------
+
+void TimeSeries::add(int64_t now_ns, uint64_t ops)
+{
+    if (now_ns >= start) {
+        const size_t index = size_t((now_ns - start) / interval);
+        if (index >= counts.size()) {
+            counts.resize(index + 1, 0);
+        }
+        counts[index] += ops;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Accumulate the time series of another thread with the same start time.
+//----------------------------------------------------------------------------
+
+void TimeSeries::merge(const TimeSeries& other)
+{
+    if (other.counts.size() > counts.size()) {
+        counts.resize(other.counts.size(), 0);
+    }
+    for (size_t i = 0; i < other.counts.size(); i++) {
+        counts[i] += other.counts[i];
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Print a time series and its initial, steady-state and minimum rates.
+//----------------------------------------------------------------------------
+
+void print_time_series(const char* name, const TimeSeries& series)
+{
+    // The last interval is incomplete, ignore it.
+    std::vector<double> rates;
+    const double per_sec = double(NSECPERSEC) / double(series.interval);
+    for (size_t i = 0; i + 1 < series.counts.size(); i++) {
+        rates.push_back(double(series.counts[i]) * per_sec);
+    }
+    if (rates.empty()) {
+        return;
+    }
+
+    // Initial rate: first 5% of the intervals. Steady state: median of the second half.
+    const size_t initial_count = std::max<size_t>(1, rates.size() / 20);
+    double initial = 0.0;
+    for (size_t i = 0; i < initial_count; i++) {
+        initial += rates[i];
+    }
+    initial /= double(initial_count);
+    std::vector<double> second_half(rates.begin() + rates.size() / 2, rates.end());
+    std::sort(second_half.begin(), second_half.end());
+    const double steady = second_half[second_half.size() / 2];
+    const double minimum = *std::min_element(rates.begin(), rates.end());
+
+    std::printf("%s-series-interval-ms: %.0f\n", name, double(series.interval) / 1000000.0);
+    std::printf("%s-series-rates:", name);
+    for (double rate : rates) {
+        std::printf(" %.0f", rate);
+    }
+    std::printf("\n");
+    std::printf("%s-series-initial-rate: %.0f\n", name, initial);
+    std::printf("%s-series-steady-rate: %.0f\n", name, steady);
+    std::printf("%s-series-min-rate: %.0f\n", name, minimum);
+    std::printf("%s-series-decay-percent: %.1f\n", name, initial > 0.0 ? 100.0 * (1.0 - steady / initial) : 0.0);
+    std::fflush(stdout);
+}
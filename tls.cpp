@@ -0,0 +1,203 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// TLS handshakes between an in-process client and server.
+//
+// The client and the server exchange their messages over a memory BIO pair,
+// there is no network and no system call. Each handshake is a full one:
+// session caching and tickets are disabled. The server certificate is
+// self-signed by the tested key pair. The client trusts it directly, so
+// it does not verify the signature of the certificate.
+//
+// The time which is spent in RSA is measured using an RSA_METHOD which
+// wraps the default one. It is installed as default method before the keys
+// are loaded, so it is used by the server key and by the public key of the
+// certificate on the client side.
+//
+//----------------------------------------------------------------------------
+
+// The RSA_METHOD API is deprecated but still the only way to intercept the RSA operations.
+#define OPENSSL_SUPPRESS_DEPRECATED 1
+
+#include "rsabench.h"
+#include <openssl/ssl.h>
+#include <openssl/rsa.h>
+
+namespace {
+    // Description of a TLS configuration.
+    struct TLSConfig
+    {
+        const char* name;        // name in the output
+        int         version;     // protocol version
+        const char* ciphers;     // cipher list (TLS 1.2) or cipher suites (TLS 1.3)
+    };
+
+    const TLSConfig TLS_CONFIGS[] = {
+        {"tls12-rsa",       TLS1_2_VERSION, "AES128-GCM-SHA256"},
+        {"tls12-ecdhe-rsa", TLS1_2_VERSION, "ECDHE-RSA-AES128-GCM-SHA256"},
+        {"tls13",           TLS1_3_VERSION, "TLS_AES_128_GCM_SHA256"},
+    };
+
+    // Accumulated time and number of RSA operations. The handshakes are single-threaded.
+    int64_t rsa_ns = 0;
+    uint64_t rsa_calls = 0;
+}
+
+
+//----------------------------------------------------------------------------
+// Timed RSA_METHOD, forwarding to the default OpenSSL implementation.
+//----------------------------------------------------------------------------
+
+template <int (*(*GETTER)(const RSA_METHOD*))(int, const unsigned char*, unsigned char*, RSA*, int)>
+static int timed_rsa(int flen, const unsigned char* from, unsigned char* to, RSA* rsa, int padding)
+{
+    const int64_t start = wall_time_ns();
+    const int ret = GETTER(RSA_PKCS1_OpenSSL())(flen, from, to, rsa, padding);
+    rsa_ns += wall_time_ns() - start;
+    rsa_calls++;
+    return ret;
+}
+
+static RSA_METHOD* new_timed_method()
+{
+    RSA_METHOD* meth = RSA_meth_dup(RSA_PKCS1_OpenSSL());
+    if (meth == nullptr ||
+        !RSA_meth_set1_name(meth, "rsabench timed RSA") ||
+        !RSA_meth_set_pub_enc(meth, timed_rsa<RSA_meth_get_pub_enc>) ||
+        !RSA_meth_set_pub_dec(meth, timed_rsa<RSA_meth_get_pub_dec>) ||
+        !RSA_meth_set_priv_enc(meth, timed_rsa<RSA_meth_get_priv_enc>) ||
+        !RSA_meth_set_priv_dec(meth, timed_rsa<RSA_meth_get_priv_dec>))
+    {
+        fatal("error creating RSA method");
+    }
+    return meth;
+}
+
+
+//----------------------------------------------------------------------------
+// Create a client or server TLS context for a configuration.
+//----------------------------------------------------------------------------
+
+static SSL_CTX* new_context(const TLSConfig& config, bool server, EVP_PKEY* key, X509* cert)
+{
+    SSL_CTX* ctx = SSL_CTX_new(server ? TLS_server_method() : TLS_client_method());
+    if (ctx == nullptr ||
+        !SSL_CTX_set_min_proto_version(ctx, config.version) ||
+        !SSL_CTX_set_max_proto_version(ctx, config.version) ||
+        !(config.version == TLS1_3_VERSION ? SSL_CTX_set_ciphersuites(ctx, config.ciphers) : SSL_CTX_set_cipher_list(ctx, config.ciphers)) ||
+        !SSL_CTX_set1_groups_list(ctx, "X25519") ||
+        !SSL_CTX_set1_sigalgs_list(ctx, "rsa_pss_rsae_sha256"))
+    {
+        fatal(std::string("error creating TLS context for ") + config.name);
+    }
+
+    // Full handshakes only.
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    SSL_CTX_set_num_tickets(ctx, 0);
+
+    if (server) {
+        if (!SSL_CTX_use_certificate(ctx, cert) || !SSL_CTX_use_PrivateKey(ctx, key) || !SSL_CTX_check_private_key(ctx)) {
+            fatal("error setting TLS server certificate");
+        }
+    }
+    else {
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+        if (!X509_STORE_add_cert(SSL_CTX_get_cert_store(ctx), cert)) {
+            fatal("error setting TLS client trusted certificate");
+        }
+    }
+    return ctx;
+}
+
+
+//----------------------------------------------------------------------------
+// Perform one complete handshake over a memory BIO pair.
+//----------------------------------------------------------------------------
+
+static void one_handshake(SSL_CTX* client_ctx, SSL_CTX* server_ctx)
+{
+    SSL* client = SSL_new(client_ctx);
+    SSL* server = SSL_new(server_ctx);
+    BIO* client_bio = nullptr;
+    BIO* server_bio = nullptr;
+    if (client == nullptr || server == nullptr || !BIO_new_bio_pair(&client_bio, 0, &server_bio, 0)) {
+        fatal("error creating TLS connection");
+    }
+    SSL_set_bio(client, client_bio, client_bio);
+    SSL_set_bio(server, server_bio, server_bio);
+    SSL_set_connect_state(client);
+    SSL_set_accept_state(server);
+
+    // Alternately run the client and the server until both complete the handshake.
+    bool client_done = false;
+    bool server_done = false;
+    while (!client_done || !server_done) {
+        for (auto* ssl : {client, server}) {
+            bool& done(ssl == client ? client_done : server_done);
+            if (!done) {
+                const int ret = SSL_do_handshake(ssl);
+                done = ret == 1;
+                const int err = done ? SSL_ERROR_NONE : SSL_get_error(ssl, ret);
+                if (err != SSL_ERROR_NONE && err != SSL_ERROR_WANT_READ && err != SSL_ERROR_WANT_WRITE) {
+                    fatal(std::string("TLS handshake error on ") + (ssl == client ? "client" : "server"));
+                }
+            }
+        }
+    }
+    SSL_free(client);
+    SSL_free(server);
+}
+
+
+//----------------------------------------------------------------------------
+// Run the TLS handshake tests.
+//----------------------------------------------------------------------------
+
+void tls_tests()
+{
+    RSA_METHOD* meth = new_timed_method();
+    RSA_set_default_method(meth);
+
+    for (const auto& key : opt.keys) {
+        const RSAKeys keys("rsa-" + key);
+        X509* cert = new_certificate("server.rsabench.local", keys.priv(), nullptr, nullptr, false);
+        std::cout << "algo: " << keys.algo() << std::endl;
+        std::cout << "key-size: " << keys.bits() << std::endl;
+
+        for (const auto& config : TLS_CONFIGS) {
+            SSL_CTX* client_ctx = new_context(config, false, nullptr, cert);
+            SSL_CTX* server_ctx = new_context(config, true, keys.priv(), cert);
+
+            // Warm up, outside measurement.
+            one_handshake(client_ctx, server_ctx);
+
+            rsa_ns = 0;
+            rsa_calls = 0;
+            uint64_t count = 0;
+            uint64_t duration = 0;
+            const int64_t wall_start = wall_time_ns();
+            const int64_t start = cpu_time();
+            do {
+                one_handshake(client_ctx, server_ctx);
+                count++;
+                duration = cpu_time() - start;
+            } while (duration < uint64_t(opt.loop_time));
+            const int64_t wall_ns = wall_time_ns() - wall_start;
+
+            const std::string name(std::string(config.name) + "-handshake");
+            print_result(name.c_str(), count, 0, duration);
+            std::cout << config.name << "-rsa-ops-per-handshake: " << (double(rsa_calls) / double(count)) << std::endl;
+            std::cout << config.name << "-rsa-percent: " << (100.0 * double(rsa_ns) / double(wall_ns)) << std::endl;
+
+            SSL_CTX_free(client_ctx);
+            SSL_CTX_free(server_ctx);
+        }
+        X509_free(cert);
+    }
+
+    RSA_set_default_method(RSA_PKCS1_OpenSSL());
+    RSA_meth_free(meth);
+}
@@ -0,0 +1,121 @@
+//----------------------------------------------------------------------------
+// rsabench - Copyright (c) 2025, Thierry Lelegard
+// BSD 2-Clause License, see LICENSE file.
+//----------------------------------------------------------------------------
+//
+// X.509 certificate chain verification.
+//
+// A local CA hierarchy is created for each key size: a root and an
+// intermediate CA, with key pairs which are generated at startup, and a
+// leaf certificate for the tested key pair. The root is the only trust
+// anchor in a prebuilt X509_STORE. Each verification checks two RSA
+// signatures: the leaf by the intermediate, the intermediate by the root.
+//
+// - cold: the leaf and intermediate certificates are decoded from DER in
+//   each iteration, with all extensions, and the intermediate is passed as
+//   untrusted certificate, as received from a TLS peer.
+// - cached: the leaf certificate is decoded once, the intermediate is
+//   cached in the store, the issuers are found by lookup in the store.
+//
+//----------------------------------------------------------------------------
+
+#include "rsabench.h"
+#include <algorithm>
+#include <openssl/x509_vfy.h>
+#include <openssl/x509v3.h>
+
+namespace {
+    // DER encoding of a certificate.
+    std::vector<uint8_t> to_der(X509* cert)
+    {
+        const int len = i2d_X509(cert, nullptr);
+        std::vector<uint8_t> der(std::max(len, 0));
+        uint8_t* p = der.data();
+        if (len <= 0 || i2d_X509(cert, &p) != len) {
+            fatal("error encoding certificate");
+        }
+        return der;
+    }
+
+    // Decode a certificate from DER.
+    X509* from_der(const std::vector<uint8_t>& der)
+    {
+        const uint8_t* p = der.data();
+        X509* cert = d2i_X509(nullptr, &p, long(der.size()));
+        if (cert == nullptr) {
+            fatal("error decoding certificate");
+        }
+        return cert;
+    }
+}
+
+
+//----------------------------------------------------------------------------
+// Verify a certificate chain. Abort on error.
+//----------------------------------------------------------------------------
+
+static void verify_chain(X509_STORE* store, X509* leaf, STACK_OF(X509)* untrusted)
+{
+    X509_STORE_CTX* ctx = X509_STORE_CTX_new();
+    if (ctx == nullptr || !X509_STORE_CTX_init(ctx, store, leaf, untrusted) || !X509_STORE_CTX_set_purpose(ctx, X509_PURPOSE_SSL_CLIENT)) {
+        fatal("error initializing certificate verification");
+    }
+    if (X509_verify_cert(ctx) != 1) {
+        fatal(std::string("certificate verification error: ") + X509_verify_cert_error_string(X509_STORE_CTX_get_error(ctx)));
+    }
+    X509_STORE_CTX_free(ctx);
+}
+
+
+//----------------------------------------------------------------------------
+// Run the X.509 chain verification tests.
+//----------------------------------------------------------------------------
+
+void x509_tests()
+{
+    for (const auto& key : opt.keys) {
+        const RSAKeys keys("rsa-" + key);
+        std::cout << "algo: " << keys.algo() << std::endl;
+        std::cout << "key-size: " << keys.bits() << std::endl;
+
+        // Build the CA hierarchy, same key size at all levels.
+        EVP_PKEY* root_key = EVP_RSA_gen(unsigned(keys.bits()));
+        EVP_PKEY* inter_key = EVP_RSA_gen(unsigned(keys.bits()));
+        if (root_key == nullptr || inter_key == nullptr) {
+            fatal("error generating CA keys");
+        }
+        X509* root = new_certificate("Root CA", root_key, nullptr, nullptr, true);
+        X509* inter = new_certificate("Intermediate CA", inter_key, root_key, root, true);
+        X509* leaf = new_certificate("client.rsabench.local", keys.pub(), inter_key, inter, false);
+        const std::vector<uint8_t> inter_der(to_der(inter));
+        const std::vector<uint8_t> leaf_der(to_der(leaf));
+        std::cout << "x509-chain-der-size: " << (leaf_der.size() + inter_der.size()) << std::endl;
+
+        // Cold: decode the leaf and the intermediate, as received from the peer.
+        X509_STORE* store = X509_STORE_new();
+        if (store == nullptr || !X509_STORE_add_cert(store, root)) {
+            fatal("error creating certificate store");
+        }
+        timed_loop("x509-verify-cold", 0, [&]() {
+            X509* l = from_der(leaf_der);
+            STACK_OF(X509)* untrusted = sk_X509_new_null();
+            sk_X509_push(untrusted, from_der(inter_der));
+            verify_chain(store, l, untrusted);
+            sk_X509_pop_free(untrusted, X509_free);
+            X509_free(l);
+        });
+
+        // Cached: the intermediate is in the store, the leaf is already decoded.
+        if (!X509_STORE_add_cert(store, inter)) {
+            fatal("error adding intermediate to certificate store");
+        }
+        timed_loop("x509-verify-cached", 0, [&]() { verify_chain(store, leaf, nullptr); });
+
+        X509_STORE_free(store);
+        X509_free(leaf);
+        X509_free(inter);
+        X509_free(root);
+        EVP_PKEY_free(inter_key);
+        EVP_PKEY_free(root_key);
+    }
+}